@@ -76,7 +76,7 @@ template<typename Key, typename Value>
 inline size_t ConcurrentMap<Key, Value>::Size() const
 {
     size_t size = 0;
-    for (auto item : concurr_map_) {
+    for (const auto& item : concurr_map_) {
         size += item.size();
     }
     return size;
@@ -0,0 +1,182 @@
+#include "corpus_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+	string_view NextField(string_view& line) {
+		const size_t tab = line.find('\t');
+		if (tab == string_view::npos) {
+			throw invalid_argument("Corpus line has too few fields"s);
+		}
+		const string_view field = line.substr(0, tab);
+		line.remove_prefix(tab + 1);
+		return field;
+	}
+
+	int ParseInt(string_view text) {
+		int value = 0;
+		const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+		if (error != errc() || end != text.data() + text.size()) {
+			throw invalid_argument("Invalid number "s + string{ text });
+		}
+		return value;
+	}
+
+	DocumentStatus ParseStatus(string_view text) {
+		if (text == "ACTUAL"sv) {
+			return DocumentStatus::ACTUAL;
+		}
+		if (text == "IRRELEVANT"sv) {
+			return DocumentStatus::IRRELEVANT;
+		}
+		if (text == "BANNED"sv) {
+			return DocumentStatus::BANNED;
+		}
+		if (text == "REMOVED"sv) {
+			return DocumentStatus::REMOVED;
+		}
+		const int value = ParseInt(text);
+		if (value < static_cast<int>(DocumentStatus::ACTUAL) || value > static_cast<int>(DocumentStatus::REMOVED)) {
+			throw invalid_argument("Invalid document status "s + string{ text });
+		}
+		return static_cast<DocumentStatus>(value);
+	}
+
+}
+
+MappedFile::MappedFile(const std::string& path)
+{
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw system_error(errno, generic_category(), "open "s + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) < 0) {
+		const int error = errno;
+		close(fd);
+		throw system_error(error, generic_category(), "fstat "s + path);
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ > 0) {
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			const int error = errno;
+			close(fd);
+			throw system_error(error, generic_category(), "mmap "s + path);
+		}
+		madvise(data, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(data);
+	}
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data_ != nullptr) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+}
+
+std::string_view MappedFile::Data() const
+{
+	return { data_, size_ };
+}
+
+SearchServer::ExternalDocument ParseCorpusLine(std::string_view line)
+{
+	if (!line.empty() && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	SearchServer::ExternalDocument document{ 0, {}, DocumentStatus::ACTUAL, {} };
+	document.id = ParseInt(NextField(line));
+	document.status = ParseStatus(NextField(line));
+	for (const string_view rating : SplitIntoWords(NextField(line))) {
+		document.ratings.push_back(ParseInt(rating));
+	}
+	document.text = line;
+	return document;
+}
+
+size_t LoadCorpus(SearchServer& search_server, const std::string& path, size_t chunk_size)
+{
+	if (chunk_size == 0) {
+		throw invalid_argument("Chunk size must be positive"s);
+	}
+	auto file = make_shared<const MappedFile>(path);
+	// Отображение должно пережить индекс, даже если загрузка прервётся исключением
+	search_server.KeepAlive(file);
+
+	string_view data = file->Data();
+	vector<string_view> lines;
+	// Номера строк в файле для сообщений об ошибках: пустые строки пропускаются
+	vector<size_t> line_numbers;
+	vector<SearchServer::ExternalDocument> documents;
+	vector<exception_ptr> errors;
+	// Параллельный алгоритм может передать копию элемента, поэтому строка
+	// обрабатывается по номеру, а не по адресу
+	vector<size_t> indices;
+	size_t line_number = 0;
+	size_t added = 0;
+
+	while (!data.empty()) {
+		lines.clear();
+		line_numbers.clear();
+		while (!data.empty() && lines.size() < chunk_size) {
+			const size_t end = min(data.find('\n'), data.size());
+			string_view line = data.substr(0, end);
+			data.remove_prefix(min(end + 1, data.size()));
+			++line_number;
+			if (!line.empty() && line.back() == '\r') {
+				line.remove_suffix(1);
+			}
+			if (!line.empty()) {
+				lines.push_back(line);
+				line_numbers.push_back(line_number);
+			}
+		}
+
+		documents.resize(lines.size());
+		errors.assign(lines.size(), nullptr);
+		indices.resize(lines.size());
+		iota(indices.begin(), indices.end(), 0);
+		for_each(execution::par,
+			indices.begin(), indices.end(),
+			[&lines, &documents, &errors](size_t i) {
+				try {
+					documents[i] = ParseCorpusLine(lines[i]);
+				}
+				catch (...) {
+					errors[i] = current_exception();
+				}
+			});
+		for (size_t i = 0; i < errors.size(); ++i) {
+			if (errors[i]) {
+				try {
+					rethrow_exception(errors[i]);
+				}
+				catch (const exception& e) {
+					throw invalid_argument("Corpus line "s + to_string(line_numbers[i]) + ": "s + e.what());
+				}
+			}
+		}
+
+		search_server.AddExternalDocuments(execution::par, documents);
+		added += documents.size();
+	}
+	return added;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	std::string_view Data() const;
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+};
+
+// Формат корпуса — по документу на строку:
+// <id>\t<статус>\t<рейтинги через пробел>\t<текст>
+// Статус задаётся именем (ACTUAL, IRRELEVANT, BANNED, REMOVED) или числом.
+// Пустые строки, в том числе последняя, пропускаются LoadCorpus.
+SearchServer::ExternalDocument ParseCorpusLine(std::string_view line);
+
+// Индексирует корпус без копирования текстов: слова документов ссылаются
+// прямо на отображение файла, которое сервер хранит до своего уничтожения.
+// Файл обрабатывается порциями по chunk_size документов, каждая порция
+// разбирается параллельно. Возвращает число добавленных документов.
+size_t LoadCorpus(SearchServer& search_server, const std::string& path, size_t chunk_size = 65536);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 
@@ -22,8 +23,9 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// Удобны для отладки; для вывода большого числа результатов есть ResultWriter
 void PrintDocument(const Document& document);
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
 
 std::ostream& operator<<(std::ostream& out, const Document& document);
\ No newline at end of file
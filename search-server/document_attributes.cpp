@@ -0,0 +1,257 @@
+#include "document_attributes.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DOCUMENT_ATTRIBUTES_X86 1
+#include <immintrin.h>
+#endif
+
+#include "prefetch.h"
+
+using namespace std;
+
+namespace {
+
+	void PrefetchAttributes(const int32_t* ids, const int32_t* ratings, const int32_t* statuses, uint32_t slot) {
+		PrefetchForRead(ids + slot);
+		PrefetchForRead(ratings + slot);
+		PrefetchForRead(statuses + slot);
+	}
+
+	// Вычисляет биты с first по count - 1
+	void EvaluateScalar(const DocumentFilter& filter, const int32_t* ids, const int32_t* ratings, const int32_t* statuses,
+		const uint32_t* slots, size_t first, size_t count, uint64_t* bits) {
+		for (size_t i = first; i < count; ++i) {
+			if (i + PREFETCH_DISTANCE < count) {
+				PrefetchAttributes(ids, ratings, statuses, slots[i + PREFETCH_DISTANCE]);
+			}
+			const uint32_t slot = slots[i];
+			const uint64_t bit = uint64_t{ 1 } << (i % 64);
+			if (ids[slot] != DocumentAttributes::FREE_SLOT_ID
+				&& filter(ids[slot], static_cast<DocumentStatus>(statuses[slot]), ratings[slot])) {
+				bits[i / 64] |= bit;
+			}
+			else {
+				bits[i / 64] &= ~bit;
+			}
+		}
+	}
+
+	// Вычисляет биты слотов с first по count - 1
+	void EvaluateSlotsScalar(const DocumentFilter& filter, const int32_t* ids, const int32_t* ratings, const int32_t* statuses,
+		size_t first, size_t count, uint64_t* bits) {
+		for (size_t slot = first; slot < count; ++slot) {
+			const uint64_t bit = uint64_t{ 1 } << (slot % 64);
+			if (ids[slot] != DocumentAttributes::FREE_SLOT_ID
+				&& filter(ids[slot], static_cast<DocumentStatus>(statuses[slot]), ratings[slot])) {
+				bits[slot / 64] |= bit;
+			}
+			else {
+				bits[slot / 64] &= ~bit;
+			}
+		}
+	}
+
+#ifdef DOCUMENT_ATTRIBUTES_X86
+	// Диапазон [min, max] включительно
+	__attribute__((target("avx2")))
+	__m256i InRange(__m256i values, int min, int max) {
+		const __m256i below = _mm256_cmpgt_epi32(_mm256_set1_epi32(min), values);
+		const __m256i above = _mm256_cmpgt_epi32(values, _mm256_set1_epi32(max));
+		return _mm256_andnot_si256(_mm256_or_si256(below, above), _mm256_set1_epi32(-1));
+	}
+
+	// Частное считается в double: для 32-битных чисел отбрасывание
+	// дробной части даёт точный результат целочисленного деления
+	__attribute__((target("avx2")))
+	__m256i HasRemainder(__m256i ids, int divisor, int remainder) {
+		const __m256d divisor4 = _mm256_set1_pd(divisor);
+		const __m128i low = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(ids)), divisor4));
+		const __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(ids, 1)), divisor4));
+		const __m256i quotients = _mm256_set_m128i(high, low);
+		const __m256i remainders = _mm256_sub_epi32(ids, _mm256_mullo_epi32(quotients, _mm256_set1_epi32(divisor)));
+		return _mm256_cmpeq_epi32(remainders, _mm256_set1_epi32(remainder));
+	}
+
+	// Маска восьми документов, проходящих хотя бы одно условие; свободные слоты не проходят
+	__attribute__((target("avx2")))
+	__m256i MatchClauses(const vector<DocumentFilter::Clause>& clauses, __m256i id8, __m256i rating8, __m256i status8) {
+		const __m256i one = _mm256_set1_epi32(1);
+		__m256i matches = _mm256_setzero_si256();
+		for (const DocumentFilter::Clause& clause : clauses) {
+			__m256i clause_matches = _mm256_and_si256(
+				InRange(id8, clause.min_id, clause.max_id),
+				InRange(rating8, clause.min_rating, clause.max_rating));
+			const __m256i status_bits = _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(clause.status_mask)), status8);
+			clause_matches = _mm256_and_si256(clause_matches, _mm256_cmpeq_epi32(_mm256_and_si256(status_bits, one), one));
+			if (clause.id_divisor != 1) {
+				clause_matches = _mm256_and_si256(clause_matches, HasRemainder(id8, clause.id_divisor, clause.id_remainder));
+			}
+			matches = _mm256_or_si256(matches, clause_matches);
+		}
+		return _mm256_andnot_si256(_mm256_cmpeq_epi32(id8, _mm256_set1_epi32(DocumentAttributes::FREE_SLOT_ID)), matches);
+	}
+
+	// Восемь бит выровнены внутри 64-битного слова, так как i кратно 8
+	__attribute__((target("avx2")))
+	void StoreMatches(__m256i matches, size_t i, uint64_t* bits) {
+		const uint64_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(matches)));
+		const unsigned shift = i % 64;
+		bits[i / 64] = (bits[i / 64] & ~(uint64_t{ 0xFF } << shift)) | (mask << shift);
+	}
+
+	__attribute__((target("avx2")))
+	void EvaluateAvx2(const DocumentFilter& filter, const int32_t* ids, const int32_t* ratings, const int32_t* statuses,
+		const uint32_t* slots, size_t count, uint64_t* bits) {
+		const auto& clauses = filter.GetClauses();
+		const __m256i all = _mm256_set1_epi32(-1);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			if (i + PREFETCH_DISTANCE + 8 <= count) {
+				for (size_t lane = 0; lane < 8; ++lane) {
+					PrefetchAttributes(ids, ratings, statuses, slots[i + PREFETCH_DISTANCE + lane]);
+				}
+			}
+			const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i));
+			const __m256i id8 = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), ids, index, all, 4);
+			const __m256i rating8 = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), ratings, index, all, 4);
+			const __m256i status8 = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), statuses, index, all, 4);
+			StoreMatches(MatchClauses(clauses, id8, rating8, status8), i, bits);
+		}
+		EvaluateScalar(filter, ids, ratings, statuses, slots, i, count, bits);
+	}
+
+	// Столбцы читаются подряд, без сбора по слотам
+	__attribute__((target("avx2")))
+	void EvaluateSlotsAvx2(const DocumentFilter& filter, const int32_t* ids, const int32_t* ratings, const int32_t* statuses,
+		size_t count, uint64_t* bits) {
+		const auto& clauses = filter.GetClauses();
+		size_t slot = 0;
+		for (; slot + 8 <= count; slot += 8) {
+			const __m256i id8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + slot));
+			const __m256i rating8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ratings + slot));
+			const __m256i status8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(statuses + slot));
+			StoreMatches(MatchClauses(clauses, id8, rating8, status8), slot, bits);
+		}
+		EvaluateSlotsScalar(filter, ids, ratings, statuses, slot, count, bits);
+	}
+
+	bool HasAvx2() {
+		static const bool supported = __builtin_cpu_supports("avx2");
+		return supported;
+	}
+#endif
+
+}
+
+DocumentAttributes::DocumentAttributes(MemoryCounter* counter)
+	: ids_(CountingAllocator<int32_t>(counter))
+	, ratings_(CountingAllocator<int32_t>(counter))
+	, statuses_(CountingAllocator<int32_t>(counter))
+{
+}
+
+uint32_t DocumentAttributes::Add(int document_id, int rating, DocumentStatus status)
+{
+	const uint32_t slot = static_cast<uint32_t>(ids_.size());
+	ids_.push_back(document_id);
+	ratings_.push_back(rating);
+	statuses_.push_back(static_cast<int32_t>(status));
+	return slot;
+}
+
+void DocumentAttributes::Free(uint32_t slot)
+{
+	ids_[slot] = FREE_SLOT_ID;
+	++free_count_;
+}
+
+bool DocumentAttributes::IsFree(uint32_t slot) const
+{
+	return ids_[slot] == FREE_SLOT_ID;
+}
+
+size_t DocumentAttributes::size() const
+{
+	return ids_.size();
+}
+
+size_t DocumentAttributes::GetFreeCount() const
+{
+	return free_count_;
+}
+
+int DocumentAttributes::GetId(uint32_t slot) const
+{
+	return ids_[slot];
+}
+
+int DocumentAttributes::GetRating(uint32_t slot) const
+{
+	return ratings_[slot];
+}
+
+DocumentStatus DocumentAttributes::GetStatus(uint32_t slot) const
+{
+	return static_cast<DocumentStatus>(statuses_[slot]);
+}
+
+void DocumentAttributes::Prefetch(uint32_t slot) const
+{
+	PrefetchAttributes(ids_.data(), ratings_.data(), statuses_.data(), slot);
+}
+
+size_t DocumentAttributes::AppendCost() const
+{
+	return ::AppendCost(ids_, 1) + ::AppendCost(ratings_, 1) + ::AppendCost(statuses_, 1);
+}
+
+void DocumentAttributes::ShrinkToFit()
+{
+	ids_.shrink_to_fit();
+	ratings_.shrink_to_fit();
+	statuses_.shrink_to_fit();
+}
+
+void DocumentAttributes::Reorder(const std::vector<uint32_t>& old_slots)
+{
+	CountedVector<int32_t> ids(ids_.get_allocator());
+	CountedVector<int32_t> ratings(ratings_.get_allocator());
+	CountedVector<int32_t> statuses(statuses_.get_allocator());
+	ids.reserve(old_slots.size());
+	ratings.reserve(old_slots.size());
+	statuses.reserve(old_slots.size());
+	free_count_ = 0;
+	for (const uint32_t slot : old_slots) {
+		ids.push_back(ids_[slot]);
+		ratings.push_back(ratings_[slot]);
+		statuses.push_back(statuses_[slot]);
+		if (ids_[slot] == FREE_SLOT_ID) {
+			++free_count_;
+		}
+	}
+	ids_ = move(ids);
+	ratings_ = move(ratings);
+	statuses_ = move(statuses);
+}
+
+void DocumentAttributes::Evaluate(const DocumentFilter& filter, const uint32_t* slots, size_t count, uint64_t* bits) const
+{
+#ifdef DOCUMENT_ATTRIBUTES_X86
+	if (HasAvx2()) {
+		EvaluateAvx2(filter, ids_.data(), ratings_.data(), statuses_.data(), slots, count, bits);
+		return;
+	}
+#endif
+	EvaluateScalar(filter, ids_.data(), ratings_.data(), statuses_.data(), slots, 0, count, bits);
+}
+
+void DocumentAttributes::EvaluateAll(const DocumentFilter& filter, uint64_t* bits) const
+{
+#ifdef DOCUMENT_ATTRIBUTES_X86
+	if (HasAvx2()) {
+		EvaluateSlotsAvx2(filter, ids_.data(), ratings_.data(), statuses_.data(), ids_.size(), bits);
+		return;
+	}
+#endif
+	EvaluateSlotsScalar(filter, ids_.data(), ratings_.data(), statuses_.data(), 0, ids_.size(), bits);
+}
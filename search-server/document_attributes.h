@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "document.h"
+#include "document_filter.h"
+#include "memory_accounting.h"
+
+// Атрибуты документов по внутренним слотам, разложенные по столбцам,
+// чтобы фильтр вычислялся пакетно векторными инструкциями.
+// Слот удалённого документа помечается id == FREE_SLOT_ID и остаётся
+// до перенумерации слотов (Reorder)
+class DocumentAttributes {
+public:
+	static const int FREE_SLOT_ID = -1;
+
+	explicit DocumentAttributes(MemoryCounter* counter);
+
+	uint32_t Add(int document_id, int rating, DocumentStatus status);
+	void Free(uint32_t slot);
+	bool IsFree(uint32_t slot) const;
+
+	size_t size() const;
+	size_t GetFreeCount() const;
+
+	int GetId(uint32_t slot) const;
+	int GetRating(uint32_t slot) const;
+	DocumentStatus GetStatus(uint32_t slot) const;
+	// Предвыборка атрибутов слота перед обращением к ним
+	void Prefetch(uint32_t slot) const;
+
+	size_t AppendCost() const;
+	void ShrinkToFit();
+
+	// Слот i получает атрибуты слота old_slots[i], остальные слоты отбрасываются
+	void Reorder(const std::vector<uint32_t>& old_slots);
+
+	// Бит i массива bits (бит i % 64 слова i / 64) устанавливается,
+	// если документ в слоте slots[i] проходит фильтр, иначе сбрасывается.
+	// Свободные слоты не проходят никакой фильтр
+	void Evaluate(const DocumentFilter& filter, const uint32_t* slots, size_t count, uint64_t* bits) const;
+	// То же для всех слотов по порядку: бит s — слот s, в bits не меньше (size() + 63) / 64 слов
+	void EvaluateAll(const DocumentFilter& filter, uint64_t* bits) const;
+
+private:
+	CountedVector<int32_t> ids_;
+	CountedVector<int32_t> ratings_;
+	CountedVector<int32_t> statuses_;
+	size_t free_count_ = 0;
+};
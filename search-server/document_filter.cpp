@@ -0,0 +1,179 @@
+#include "document_filter.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+	// Условие, которому не удовлетворяет ни один документ
+	DocumentFilter::Clause MakeEmptyClause() {
+		DocumentFilter::Clause clause;
+		clause.status_mask = 0;
+		return clause;
+	}
+
+	int64_t Gcd(int64_t lhs, int64_t rhs) {
+		while (rhs != 0) {
+			lhs %= rhs;
+			swap(lhs, rhs);
+		}
+		return lhs;
+	}
+
+	// Обратный к value по взаимно простому с ним модулю
+	int64_t InverseModulo(int64_t value, int64_t modulo) {
+		int64_t old_r = value, r = modulo;
+		int64_t old_s = 1, s = 0;
+		while (r != 0) {
+			const int64_t quotient = old_r / r;
+			old_r -= quotient * r;
+			swap(old_r, r);
+			old_s -= quotient * s;
+			swap(old_s, s);
+		}
+		return (old_s % modulo + modulo) % modulo;
+	}
+
+	DocumentFilter::Clause Intersect(const DocumentFilter::Clause& lhs, const DocumentFilter::Clause& rhs) {
+		DocumentFilter::Clause result;
+		result.min_id = max(lhs.min_id, rhs.min_id);
+		result.max_id = min(lhs.max_id, rhs.max_id);
+		result.min_rating = max(lhs.min_rating, rhs.min_rating);
+		result.max_rating = min(lhs.max_rating, rhs.max_rating);
+		result.status_mask = lhs.status_mask & rhs.status_mask;
+
+		// Два условия на остаток сводятся к одному по модулю НОК делителей
+		// (китайская теорема об остатках)
+		const int64_t gcd = Gcd(lhs.id_divisor, rhs.id_divisor);
+		const int64_t difference = static_cast<int64_t>(rhs.id_remainder) - lhs.id_remainder;
+		if (difference % gcd != 0) {
+			return MakeEmptyClause();
+		}
+		const int64_t lhs_step = lhs.id_divisor / gcd;
+		const int64_t rhs_step = rhs.id_divisor / gcd;
+		const int64_t lcm = lhs_step * rhs.id_divisor;
+		// k: lhs.id_remainder + lhs.id_divisor * k ≡ rhs.id_remainder (mod rhs.id_divisor)
+		int64_t k = (difference / gcd % rhs_step + rhs_step) % rhs_step;
+		k = k * InverseModulo(lhs_step % rhs_step, rhs_step) % rhs_step;
+		const int64_t remainder = lhs.id_remainder + lhs.id_divisor * k;
+		if (lcm <= numeric_limits<int>::max()) {
+			result.id_divisor = static_cast<int>(lcm);
+			result.id_remainder = static_cast<int>(remainder);
+		}
+		// Остаток по модулю больше любого id даёт только id, равный остатку
+		else if (remainder <= numeric_limits<int>::max()) {
+			result.min_id = max(result.min_id, static_cast<int>(remainder));
+			result.max_id = min(result.max_id, static_cast<int>(remainder));
+		}
+		else {
+			return MakeEmptyClause();
+		}
+		return result;
+	}
+
+}
+
+bool DocumentFilter::Clause::Matches(int document_id, DocumentStatus status, int rating) const
+{
+	return document_id >= min_id && document_id <= max_id
+		&& rating >= min_rating && rating <= max_rating
+		&& ((status_mask >> static_cast<uint32_t>(status)) & 1u) != 0
+		&& document_id % id_divisor == id_remainder;
+}
+
+DocumentFilter::DocumentFilter()
+{
+	static const auto all_documents = make_shared<const vector<Clause>>(1);
+	clauses_ = all_documents;
+}
+
+DocumentFilter::DocumentFilter(std::vector<Clause> clauses)
+	: clauses_(make_shared<const vector<Clause>>(move(clauses)))
+{
+}
+
+DocumentFilter DocumentFilter::IdBetween(int min_id, int max_id)
+{
+	Clause clause;
+	clause.min_id = min_id;
+	clause.max_id = max_id;
+	return DocumentFilter({ clause });
+}
+
+DocumentFilter DocumentFilter::IdModulo(int divisor, int remainder)
+{
+	if (divisor <= 0 || remainder < 0 || remainder >= divisor) {
+		throw invalid_argument("Invalid id divisor or remainder"s);
+	}
+	Clause clause;
+	clause.id_divisor = divisor;
+	clause.id_remainder = remainder;
+	return DocumentFilter({ clause });
+}
+
+DocumentFilter DocumentFilter::RatingBetween(int min_rating, int max_rating)
+{
+	Clause clause;
+	clause.min_rating = min_rating;
+	clause.max_rating = max_rating;
+	return DocumentFilter({ clause });
+}
+
+DocumentFilter DocumentFilter::Status(DocumentStatus status)
+{
+	// Фильтры по одному статусу создаются один раз
+	static const DocumentFilter filters[] = {
+		StatusIn({ DocumentStatus::ACTUAL }),
+		StatusIn({ DocumentStatus::IRRELEVANT }),
+		StatusIn({ DocumentStatus::BANNED }),
+		StatusIn({ DocumentStatus::REMOVED }),
+	};
+	const size_t index = static_cast<size_t>(status);
+	return index < size(filters) ? filters[index] : StatusIn({ status });
+}
+
+DocumentFilter DocumentFilter::StatusIn(std::initializer_list<DocumentStatus> statuses)
+{
+	Clause clause;
+	clause.status_mask = 0;
+	for (const DocumentStatus status : statuses) {
+		clause.status_mask |= 1u << static_cast<uint32_t>(status);
+	}
+	return DocumentFilter({ clause });
+}
+
+bool DocumentFilter::operator()(int document_id, DocumentStatus status, int rating) const
+{
+	return any_of(clauses_->begin(), clauses_->end(), [=](const Clause& clause) {
+		return clause.Matches(document_id, status, rating);
+		});
+}
+
+const std::vector<DocumentFilter::Clause>& DocumentFilter::GetClauses() const
+{
+	return *clauses_;
+}
+
+DocumentFilter operator&&(const DocumentFilter& lhs, const DocumentFilter& rhs)
+{
+	vector<DocumentFilter::Clause> clauses;
+	clauses.reserve(lhs.clauses_->size() * rhs.clauses_->size());
+	for (const auto& left : *lhs.clauses_) {
+		for (const auto& right : *rhs.clauses_) {
+			clauses.push_back(Intersect(left, right));
+		}
+	}
+	return DocumentFilter(move(clauses));
+}
+
+DocumentFilter operator||(const DocumentFilter& lhs, const DocumentFilter& rhs)
+{
+	vector<DocumentFilter::Clause> clauses(*lhs.clauses_);
+	clauses.insert(clauses.end(), rhs.clauses_->begin(), rhs.clauses_->end());
+	return DocumentFilter(move(clauses));
+}
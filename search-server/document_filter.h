@@ -0,0 +1,56 @@
+#pragma once
+
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "document.h"
+
+// Декларативный фильтр документов по id, статусу и рейтингу.
+// Хранится как дизъюнкция конъюнкций условий, поэтому вычисляется
+// пакетно над столбцами атрибутов (см. DocumentAttributes::Evaluate).
+// Можно передавать везде, где принимается DocumentPredicate.
+// Условия неизменяемы и разделяются копиями, поэтому копирование не выделяет память
+class DocumentFilter {
+public:
+	// Конъюнкция условий, поля по умолчанию пропускают любой документ
+	struct Clause {
+		int min_id = std::numeric_limits<int>::min();
+		int max_id = std::numeric_limits<int>::max();
+		int min_rating = std::numeric_limits<int>::min();
+		int max_rating = std::numeric_limits<int>::max();
+		// Бит s установлен, если допустим статус s
+		uint32_t status_mask = ALL_STATUSES;
+		// id % id_divisor == id_remainder. Пересечение условий с разными
+		// делителями сводится к делителю, равному их НОК
+		int id_divisor = 1;
+		int id_remainder = 0;
+
+		bool Matches(int document_id, DocumentStatus status, int rating) const;
+	};
+
+	static const uint32_t ALL_STATUSES = ~0u;
+
+	// Пропускает все документы
+	DocumentFilter();
+
+	static DocumentFilter IdBetween(int min_id, int max_id);
+	static DocumentFilter IdModulo(int divisor, int remainder);
+	static DocumentFilter RatingBetween(int min_rating, int max_rating);
+	static DocumentFilter Status(DocumentStatus status);
+	static DocumentFilter StatusIn(std::initializer_list<DocumentStatus> statuses);
+
+	bool operator()(int document_id, DocumentStatus status, int rating) const;
+
+	const std::vector<Clause>& GetClauses() const;
+
+	friend DocumentFilter operator&&(const DocumentFilter& lhs, const DocumentFilter& rhs);
+	friend DocumentFilter operator||(const DocumentFilter& lhs, const DocumentFilter& rhs);
+
+private:
+	explicit DocumentFilter(std::vector<Clause> clauses);
+
+	std::shared_ptr<const std::vector<Clause>> clauses_;
+};
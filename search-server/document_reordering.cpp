@@ -0,0 +1,154 @@
+#include "document_reordering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+	// Оценка длины закодированных разрывов слова, встречающегося
+	// в degree документах части из size документов
+	double ComputeGapCost(uint32_t degree, double size) {
+		return degree == 0 ? 0.0 : degree * log2(size / (degree + 1));
+	}
+
+	class Bisection {
+	public:
+		Bisection(const DocumentTermMatrix& documents, const DocumentReorderOptions& options)
+			: documents_(documents)
+			, options_(options)
+			, left_degrees_(documents.term_count, 0)
+			, right_degrees_(documents.term_count, 0)
+			, stamps_(documents.term_count, 0)
+			, left_to_right_gains_(documents.term_count, 0.0)
+			, right_to_left_gains_(documents.term_count, 0.0)
+			, document_gains_(documents.size(), 0.0)
+		{
+		}
+
+		// Упорядочивает документы order[first, last)
+		void Run(uint32_t* first, uint32_t* last) {
+			const size_t size = last - first;
+			if (size <= options_.leaf_size) {
+				return;
+			}
+			uint32_t* const middle = first + size / 2;
+			for (const uint32_t* it = first; it != last; ++it) {
+				AddDegrees(*it, it < middle ? left_degrees_ : right_degrees_, 1);
+			}
+			for (size_t iteration = 0; iteration < options_.max_iterations; ++iteration) {
+				if (!Refine(first, middle, last)) {
+					break;
+				}
+			}
+			for (const uint32_t* it = first; it != last; ++it) {
+				AddDegrees(*it, it < middle ? left_degrees_ : right_degrees_, -1);
+			}
+			Run(first, middle);
+			Run(middle, last);
+		}
+
+	private:
+		const DocumentTermMatrix& documents_;
+		const DocumentReorderOptions& options_;
+		vector<uint32_t> left_degrees_;
+		vector<uint32_t> right_degrees_;
+		// Выигрыш переноса слова пересчитывается один раз за итерацию
+		vector<uint32_t> stamps_;
+		uint32_t stamp_ = 0;
+		vector<double> left_to_right_gains_;
+		vector<double> right_to_left_gains_;
+		vector<double> document_gains_;
+
+		void AddDegrees(uint32_t document, vector<uint32_t>& degrees, int delta) {
+			for (size_t i = documents_.offsets[document]; i < documents_.offsets[document + 1]; ++i) {
+				degrees[documents_.terms[i]] += delta;
+			}
+		}
+
+		// Одна итерация обменов; false, если обменивать нечего
+		bool Refine(uint32_t* first, uint32_t* middle, uint32_t* last) {
+			const double left_size = static_cast<double>(middle - first);
+			const double right_size = static_cast<double>(last - middle);
+			++stamp_;
+			for (const uint32_t* it = first; it != last; ++it) {
+				const bool is_left = it < middle;
+				double gain = 0.0;
+				for (size_t i = documents_.offsets[*it]; i < documents_.offsets[*it + 1]; ++i) {
+					const uint32_t term = documents_.terms[i];
+					if (stamps_[term] != stamp_) {
+						stamps_[term] = stamp_;
+						const uint32_t left = left_degrees_[term];
+						const uint32_t right = right_degrees_[term];
+						const double cost = ComputeGapCost(left, left_size) + ComputeGapCost(right, right_size);
+						left_to_right_gains_[term] = left == 0 ? 0.0
+							: cost - ComputeGapCost(left - 1, left_size) - ComputeGapCost(right + 1, right_size);
+						right_to_left_gains_[term] = right == 0 ? 0.0
+							: cost - ComputeGapCost(left + 1, left_size) - ComputeGapCost(right - 1, right_size);
+					}
+					gain += is_left ? left_to_right_gains_[term] : right_to_left_gains_[term];
+				}
+				document_gains_[*it] = gain;
+			}
+
+			const auto by_gain = [this](uint32_t lhs, uint32_t rhs) {
+				return document_gains_[lhs] > document_gains_[rhs]
+					|| (document_gains_[lhs] == document_gains_[rhs] && lhs < rhs);
+			};
+			sort(first, middle, by_gain);
+			sort(middle, last, by_gain);
+
+			bool swapped = false;
+			for (uint32_t* left = first, *right = middle; left != middle && right != last; ++left, ++right) {
+				if (document_gains_[*left] + document_gains_[*right] <= 0.0) {
+					break;
+				}
+				AddDegrees(*left, left_degrees_, -1);
+				AddDegrees(*left, right_degrees_, 1);
+				AddDegrees(*right, right_degrees_, -1);
+				AddDegrees(*right, left_degrees_, 1);
+				swap(*left, *right);
+				swapped = true;
+			}
+			return swapped;
+		}
+	};
+
+}
+
+size_t DocumentTermMatrix::size() const
+{
+	return offsets.size() - 1;
+}
+
+std::vector<uint32_t> ComputeLocalityOrder(const DocumentTermMatrix& documents, const DocumentReorderOptions& options)
+{
+	if (options.leaf_size == 0) {
+		throw invalid_argument("Leaf size must be positive"s);
+	}
+	vector<uint32_t> order(documents.size());
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	Bisection(documents, options).Run(order.data(), order.data() + order.size());
+	return order;
+}
+
+size_t CountGapBits(const uint32_t* slots, size_t count)
+{
+	size_t bits = 0;
+	uint64_t previous = 0;
+	for (size_t i = 0; i < count; ++i) {
+		// Первый разрыв — от -1, то есть slots[0] + 1
+		uint64_t gap = static_cast<uint64_t>(slots[i]) + 1 - previous;
+		previous = static_cast<uint64_t>(slots[i]) + 1;
+		while (gap > 0) {
+			++bits;
+			gap >>= 1;
+		}
+	}
+	return bits;
+}
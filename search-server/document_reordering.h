@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_accounting.h"
+
+// Документы как множества слов в построчном виде: слова документа i —
+// terms[offsets[i]] .. terms[offsets[i + 1]] - 1, номера слов меньше term_count
+struct DocumentTermMatrix {
+	std::vector<size_t> offsets{ 0 };
+	std::vector<uint32_t> terms;
+	size_t term_count = 0;
+
+	size_t size() const;
+};
+
+struct DocumentReorderOptions {
+	// Число обменов между половинами на каждом уровне разбиения
+	size_t max_iterations = 12;
+	// Части не больше этой не делятся
+	size_t leaf_size = 16;
+};
+
+// Порядок документов рекурсивной бисекцией графа документов и слов:
+// каждая часть делится пополам, и документы обмениваются между половинами,
+// пока это уменьшает оценку длины закодированных разрывов между соседними
+// вхождениями, d * log2(n / (d + 1)) для слова в d документах половины из n.
+// Документы с общими словами оказываются рядом.
+// Возвращает номера документов в новом порядке
+std::vector<uint32_t> ComputeLocalityOrder(const DocumentTermMatrix& documents, const DocumentReorderOptions& options = {});
+
+// Сумма длин записи разрывов между соседними слотами возрастающего списка
+// в битах: разрыв g занимает floor(log2 g) + 1 бит, первый слот считается
+// разрывом от -1. Оценка размера списка при сжатии разностей
+size_t CountGapBits(const uint32_t* slots, size_t count);
+
+struct DocumentReorderStats {
+	// Слоты до перенумерации включают освобождённые удалением документов
+	size_t slots_before = 0;
+	size_t slots_after = 0;
+	// Средняя длина записи разрыва на вхождение, см. CountGapBits
+	double gap_bits_before = 0.0;
+	double gap_bits_after = 0.0;
+	MemoryStats memory_before;
+	MemoryStats memory_after;
+};
@@ -0,0 +1,124 @@
+#include "execution_cost_model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "score_kernel.h"
+
+using namespace std;
+
+namespace {
+
+	// Медиана нескольких замеров, устойчивая к вытеснению потока
+	template <typename Function>
+	double MedianNanoseconds(size_t repeat_count, Function function) {
+		vector<double> samples;
+		samples.reserve(repeat_count);
+		for (size_t i = 0; i < repeat_count; ++i) {
+			const auto start = chrono::steady_clock::now();
+			function();
+			const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+			samples.push_back(elapsed.count());
+		}
+		nth_element(samples.begin(), samples.begin() + repeat_count / 2, samples.end());
+		return samples[repeat_count / 2];
+	}
+
+}
+
+const ExecutionCostModel& ExecutionCostModel::Instance()
+{
+	static const ExecutionCostModel model = Calibrate();
+	return model;
+}
+
+ExecutionCostModel::ExecutionCostModel(size_t thread_count, double dispatch_ns, double operation_ns)
+	: thread_count_(max<size_t>(thread_count, 1))
+	, dispatch_ns_(dispatch_ns)
+	, operation_ns_(max(operation_ns, 1e-3))
+{
+	min_task_work_ = static_cast<size_t>(ceil(dispatch_ns_ / operation_ns_));
+	if (thread_count_ == 1) {
+		min_parallel_work_ = numeric_limits<size_t>::max();
+	}
+	else {
+		// work * t * (1 - 1 / p) > dispatch, с двукратным запасом
+		const double threads = static_cast<double>(thread_count_);
+		min_parallel_work_ = static_cast<size_t>(ceil(2.0 * min_task_work_ * threads / (threads - 1)));
+	}
+}
+
+bool ExecutionCostModel::ShouldParallelize(size_t work) const
+{
+	return work >= min_parallel_work_;
+}
+
+size_t ExecutionCostModel::ChooseTaskCount(size_t work) const
+{
+	const size_t max_task_count = thread_count_ * TASKS_PER_THREAD;
+	return clamp<size_t>(work / max<size_t>(min_task_work_, 1), 1, max_task_count);
+}
+
+size_t ExecutionCostModel::GetThreadCount() const
+{
+	return thread_count_;
+}
+
+double ExecutionCostModel::GetDispatchNanoseconds() const
+{
+	return dispatch_ns_;
+}
+
+double ExecutionCostModel::GetOperationNanoseconds() const
+{
+	return operation_ns_;
+}
+
+size_t ExecutionCostModel::GetMinParallelWork() const
+{
+	return min_parallel_work_;
+}
+
+ExecutionCostModel ExecutionCostModel::Calibrate()
+{
+	const size_t thread_count = max(thread::hardware_concurrency(), 1u);
+	if (thread_count == 1) {
+		return { 1, 0.0, 1.0 };
+	}
+
+	// Операция — накопление релевантности по вхождениям вразброс, как при поиске
+	const size_t OPERATION_COUNT = 1 << 16;
+	vector<uint32_t> slots(OPERATION_COUNT);
+	for (size_t i = 0; i < OPERATION_COUNT; ++i) {
+		// Нечётный множитель по модулю степени двойки даёт перестановку
+		slots[i] = static_cast<uint32_t>((i * 40503) % OPERATION_COUNT);
+	}
+	const vector<double> term_freqs(OPERATION_COUNT, 0.5);
+	vector<double> scores(OPERATION_COUNT, 0.0);
+	const double operation_ns = MedianNanoseconds(5, [&] {
+		AccumulateScores(slots.data(), term_freqs.data(), OPERATION_COUNT, 1.5, scores.data());
+		}) / OPERATION_COUNT;
+
+	// Задержка запуска — параллельный обход диапазона с пустой работой
+	vector<int> tasks(thread_count * TASKS_PER_THREAD);
+	const auto dispatch = [&tasks] {
+		for_each(execution::par, tasks.begin(), tasks.end(), [](int& task) {
+			++task;
+			});
+	};
+	dispatch();
+	const double dispatch_ns = MedianNanoseconds(16, dispatch);
+
+	return { thread_count, dispatch_ns, operation_ns };
+}
+
+size_t SortWork(size_t n)
+{
+	return n < 2 ? n : static_cast<size_t>(n * log2(static_cast<double>(n)));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+// Модель стоимости параллельного выполнения. Работа измеряется
+// в элементарных операциях — обработке одного вхождения слова.
+// Параллельный запуск выгоден, когда выигрыш от деления работы
+// между потоками больше задержки запуска задач
+class ExecutionCostModel {
+public:
+	// Модель, откалиброванная микробенчмарком при первом обращении
+	static const ExecutionCostModel& Instance();
+
+	ExecutionCostModel(size_t thread_count, double dispatch_ns, double operation_ns);
+
+	bool ShouldParallelize(size_t work) const;
+
+	// Число задач, на которое стоит делить работу: каждая задача
+	// должна окупать свой запуск, но не больше нескольких на поток
+	size_t ChooseTaskCount(size_t work) const;
+
+	size_t GetThreadCount() const;
+	double GetDispatchNanoseconds() const;
+	double GetOperationNanoseconds() const;
+	size_t GetMinParallelWork() const;
+
+private:
+	static const size_t TASKS_PER_THREAD = 4;
+
+	size_t thread_count_;
+	double dispatch_ns_;
+	double operation_ns_;
+	size_t min_parallel_work_;
+	size_t min_task_work_;
+
+	static ExecutionCostModel Calibrate();
+};
+
+// Оценка числа операций сортировки n элементов
+size_t SortWork(size_t n);
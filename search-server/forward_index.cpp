@@ -0,0 +1,106 @@
+#include "forward_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "prefetch.h"
+
+using namespace std;
+
+WordFrequencies::WordFrequencies(const_iterator first, const_iterator last)
+	: first_(first)
+	, last_(last)
+{
+}
+
+WordFrequencies::const_iterator WordFrequencies::begin() const
+{
+	return first_;
+}
+
+WordFrequencies::const_iterator WordFrequencies::end() const
+{
+	return last_;
+}
+
+size_t WordFrequencies::size() const
+{
+	return last_ - first_;
+}
+
+bool WordFrequencies::empty() const
+{
+	return first_ == last_;
+}
+
+WordFrequencies::const_iterator WordFrequencies::find(std::string_view word) const
+{
+	const auto it = lower_bound(first_, last_, word, [](const WordFrequency& lhs, string_view rhs) {
+		return lhs.first < rhs;
+		});
+	return (it != last_ && it->first == word) ? it : last_;
+}
+
+size_t WordFrequencies::count(std::string_view word) const
+{
+	return find(word) != last_;
+}
+
+double WordFrequencies::at(std::string_view word) const
+{
+	const auto it = find(word);
+	if (it == last_) {
+		throw out_of_range("WordFrequencies::at"s);
+	}
+	return it->second;
+}
+
+ForwardIndex::ForwardIndex(MemoryCounter* counter)
+	: entries_(CountingAllocator<WordFrequency>(counter))
+{
+}
+
+ForwardIndex::Range ForwardIndex::Add(const std::vector<WordFrequency>& words)
+{
+	const Range range{ entries_.size(), static_cast<uint32_t>(words.size()) };
+	entries_.insert(entries_.end(), words.begin(), words.end());
+	return range;
+}
+
+void ForwardIndex::Remove(const Range& range)
+{
+	garbage_ += range.size;
+}
+
+WordFrequencies ForwardIndex::Get(const Range& range) const
+{
+	const WordFrequency* first = entries_.data() + range.offset;
+	return { first, first + range.size };
+}
+
+// Слова документа читаются слиянием от начала участка; дальше
+// строки подтягивает аппаратная предвыборка
+void ForwardIndex::Prefetch(const Range& range) const
+{
+	const size_t PREFETCH_LINES = 4;
+	const char* first = reinterpret_cast<const char*>(entries_.data() + range.offset);
+	const char* last = reinterpret_cast<const char*>(entries_.data() + range.offset + range.size);
+	for (size_t line = 0; line < PREFETCH_LINES && first + line * 64 < last; ++line) {
+		PrefetchForRead(first + line * 64);
+	}
+}
+
+bool ForwardIndex::NeedsCompaction() const
+{
+	return garbage_ > 0 && garbage_ * 2 >= entries_.size();
+}
+
+bool ForwardIndex::HasGarbage() const
+{
+	return garbage_ > 0;
+}
+
+size_t ForwardIndex::AppendCost(size_t count) const
+{
+	return ::AppendCost(entries_, count);
+}
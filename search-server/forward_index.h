@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "memory_accounting.h"
+
+using WordFrequency = std::pair<std::string_view, double>;
+
+// Лёгкое представление частот слов одного документа: отсортированный
+// по слову непрерывный участок общего хранилища ForwardIndex.
+// Становится недействительным после добавления или удаления документов.
+class WordFrequencies {
+public:
+	using const_iterator = const WordFrequency*;
+
+	WordFrequencies() = default;
+	WordFrequencies(const_iterator first, const_iterator last);
+
+	const_iterator begin() const;
+	const_iterator end() const;
+	size_t size() const;
+	bool empty() const;
+
+	const_iterator find(std::string_view word) const;
+	size_t count(std::string_view word) const;
+	double at(std::string_view word) const;
+
+private:
+	const_iterator first_ = nullptr;
+	const_iterator last_ = nullptr;
+};
+
+// Прямой индекс: частоты слов всех документов в одном массиве.
+// Удалённые участки копятся как мусор и вычищаются при сжатии.
+class ForwardIndex {
+public:
+	struct Range {
+		size_t offset = 0;
+		uint32_t size = 0;
+	};
+
+	explicit ForwardIndex(MemoryCounter* counter);
+
+	// words должны быть отсортированы по слову и уникальны
+	Range Add(const std::vector<WordFrequency>& words);
+	void Remove(const Range& range);
+	WordFrequencies Get(const Range& range) const;
+	// Предвыборка первых строк кэша участка
+	void Prefetch(const Range& range) const;
+
+	bool NeedsCompaction() const;
+	bool HasGarbage() const;
+	size_t AppendCost(size_t count) const;
+
+	// for_each_range(f) должен вызвать f(Range&) для каждого живого участка
+	template <typename ForEachRange>
+	void Compact(ForEachRange for_each_range);
+
+private:
+	CountedVector<WordFrequency> entries_;
+	size_t garbage_ = 0;
+};
+
+template<typename ForEachRange>
+inline void ForwardIndex::Compact(ForEachRange for_each_range)
+{
+	CountedVector<WordFrequency> compacted(entries_.get_allocator());
+	compacted.reserve(entries_.size() - garbage_);
+	for_each_range([this, &compacted](Range& range) {
+		const size_t offset = compacted.size();
+		compacted.insert(compacted.end(), entries_.begin() + range.offset, entries_.begin() + range.offset + range.size);
+		range.offset = offset;
+		});
+	entries_ = std::move(compacted);
+	garbage_ = 0;
+}
@@ -0,0 +1,163 @@
+#include "index_arena.h"
+
+#include <algorithm>
+#include <new>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace {
+
+	// Блоки от строки кэша и больше не пересекают лишних строк
+	const size_t CACHE_LINE_SIZE = 64;
+
+	size_t RoundUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+}
+
+IndexArena::~IndexArena()
+{
+	for (const Region& chunk : chunks_) {
+		UnmapRegion(chunk);
+	}
+}
+
+void* IndexArena::Allocate(size_t bytes)
+{
+	if (bytes > MAX_BLOCK_SIZE) {
+		const Region region = MapRegion(RoundUp(bytes, HUGE_PAGE_SIZE));
+		lock_guard guard(mutex_);
+		stats_.mapped_bytes += region.size;
+		if (region.is_hugetlb) {
+			stats_.hugetlb_bytes += region.size;
+			hugetlb_blocks_.insert(region.address);
+		}
+		return region.address;
+	}
+
+	const size_t size_class = GetSizeClass(bytes);
+	const size_t block_size = size_t{ 1 } << (size_class + MIN_BLOCK_SHIFT);
+	lock_guard guard(mutex_);
+	if (FreeBlock* block = free_lists_[size_class]) {
+		free_lists_[size_class] = block->next;
+		stats_.free_bytes -= block_size;
+		return block;
+	}
+
+	const size_t alignment = min(block_size, CACHE_LINE_SIZE);
+	char* block = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(current_), alignment));
+	if (current_ == nullptr || block + block_size > end_) {
+		const Region chunk = MapRegion(CHUNK_SIZE);
+		chunks_.push_back(chunk);
+		stats_.mapped_bytes += chunk.size;
+		if (chunk.is_hugetlb) {
+			stats_.hugetlb_bytes += chunk.size;
+		}
+		// Остаток прежнего участка не теряется
+		AddFreeRange(current_, end_);
+		current_ = static_cast<char*>(chunk.address);
+		end_ = current_ + chunk.size;
+		block = current_;
+	}
+	AddFreeRange(current_, block);
+	current_ = block + block_size;
+	return block;
+}
+
+void IndexArena::Deallocate(void* pointer, size_t bytes) noexcept
+{
+	if (pointer == nullptr) {
+		return;
+	}
+	if (bytes > MAX_BLOCK_SIZE) {
+		Region region{ pointer, RoundUp(bytes, HUGE_PAGE_SIZE), false };
+		{
+			lock_guard guard(mutex_);
+			stats_.mapped_bytes -= region.size;
+			if (hugetlb_blocks_.erase(pointer) > 0) {
+				region.is_hugetlb = true;
+				stats_.hugetlb_bytes -= region.size;
+			}
+		}
+		UnmapRegion(region);
+		return;
+	}
+
+	const size_t size_class = GetSizeClass(bytes);
+	lock_guard guard(mutex_);
+	FreeBlock* block = static_cast<FreeBlock*>(pointer);
+	block->next = free_lists_[size_class];
+	free_lists_[size_class] = block;
+	stats_.free_bytes += size_t{ 1 } << (size_class + MIN_BLOCK_SHIFT);
+}
+
+IndexArena::Stats IndexArena::GetStats() const
+{
+	lock_guard guard(mutex_);
+	return stats_;
+}
+
+size_t IndexArena::GetSizeClass(size_t bytes)
+{
+	size_t size_class = 0;
+	while ((size_t{ 1 } << (size_class + MIN_BLOCK_SHIFT)) < bytes) {
+		++size_class;
+	}
+	return size_class;
+}
+
+// Границы кратны минимальному блоку, поэтому остаток раскладывается целиком
+void IndexArena::AddFreeRange(char* first, char* last)
+{
+	while (first != nullptr && static_cast<size_t>(last - first) >= (size_t{ 1 } << MIN_BLOCK_SHIFT)) {
+		size_t size_class = CLASS_COUNT - 1;
+		while ((size_t{ 1 } << (size_class + MIN_BLOCK_SHIFT)) > static_cast<size_t>(last - first)) {
+			--size_class;
+		}
+		FreeBlock* block = reinterpret_cast<FreeBlock*>(first);
+		block->next = free_lists_[size_class];
+		free_lists_[size_class] = block;
+		const size_t block_size = size_t{ 1 } << (size_class + MIN_BLOCK_SHIFT);
+		stats_.free_bytes += block_size;
+		first += block_size;
+	}
+}
+
+IndexArena::Region IndexArena::MapRegion(size_t size)
+{
+#ifdef MAP_HUGETLB
+	void* hugetlb = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (hugetlb != MAP_FAILED) {
+		return { hugetlb, size, true };
+	}
+#endif
+	// Лишние HUGE_PAGE_SIZE байт позволяют выровнять начало участка,
+	// без чего ядро не может отобразить его большими страницами
+	const size_t mapped_size = size + HUGE_PAGE_SIZE;
+	void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapped == MAP_FAILED) {
+		throw bad_alloc();
+	}
+	char* const begin = static_cast<char*>(mapped);
+	char* const aligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(begin), HUGE_PAGE_SIZE));
+	if (aligned != begin) {
+		munmap(begin, aligned - begin);
+	}
+	char* const end = begin + mapped_size;
+	if (aligned + size != end) {
+		munmap(aligned + size, end - (aligned + size));
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+	return { aligned, size, false };
+}
+
+void IndexArena::UnmapRegion(const Region& region) noexcept
+{
+	munmap(region.address, region.size);
+}
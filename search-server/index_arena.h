@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <cstddef>
+
+// Откуда берётся память списков вхождений, прямого индекса и атрибутов
+enum class IndexAllocation {
+	// Обычная куча: много мелких блоков на страницах по 4 КиБ
+	HEAP,
+	// Крупные участки IndexArena на больших страницах
+	HUGE_PAGES,
+};
+
+// Арена индекса на больших страницах. Память выделяется участками
+// по CHUNK_SIZE, выровненными на 2 МиБ: сначала с MAP_HUGETLB (нужны
+// заранее выделенные страницы, vm.nr_hugepages), иначе обычным mmap
+// с madvise(MADV_HUGEPAGE) для прозрачных больших страниц.
+// Блоки округляются вверх до степени двойки, освобождённые блоки
+// переиспользуются для того же размера и ОС не возвращаются.
+// Блоки больше MAX_BLOCK_SIZE отображаются отдельно и освобождаются сразу
+class IndexArena {
+public:
+	static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+	static const size_t CHUNK_SIZE = 16 * HUGE_PAGE_SIZE;
+	static const size_t MAX_BLOCK_SIZE = HUGE_PAGE_SIZE / 2;
+
+	struct Stats {
+		// Отображено арены, в том числе свободные блоки
+		size_t mapped_bytes = 0;
+		// Из них на страницах MAP_HUGETLB; остальное — на прозрачных
+		// больших страницах, если ядро их выделило
+		size_t hugetlb_bytes = 0;
+		// В списках свободных блоков
+		size_t free_bytes = 0;
+	};
+
+	IndexArena() = default;
+	~IndexArena();
+
+	IndexArena(const IndexArena&) = delete;
+	IndexArena& operator=(const IndexArena&) = delete;
+
+	// Выравнивание блока не меньше alignof(std::max_align_t).
+	// При нехватке памяти выбрасывается std::bad_alloc
+	void* Allocate(size_t bytes);
+	// bytes — тот же размер, что при выделении
+	void Deallocate(void* pointer, size_t bytes) noexcept;
+
+	Stats GetStats() const;
+
+private:
+	static const size_t MIN_BLOCK_SHIFT = 4;
+	static const size_t CLASS_COUNT = 17;
+
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	struct Region {
+		void* address = nullptr;
+		size_t size = 0;
+		bool is_hugetlb = false;
+	};
+
+	mutable std::mutex mutex_;
+	std::array<FreeBlock*, CLASS_COUNT> free_lists_{};
+	char* current_ = nullptr;
+	char* end_ = nullptr;
+	std::vector<Region> chunks_;
+	// Отдельно отображённые крупные блоки на страницах MAP_HUGETLB
+	std::unordered_set<void*> hugetlb_blocks_;
+	Stats stats_;
+
+	static size_t GetSizeClass(size_t bytes);
+	// Раскладывает [first, last) по спискам свободных блоков
+	void AddFreeRange(char* first, char* last);
+	// Участок, выровненный на HUGE_PAGE_SIZE; size кратно HUGE_PAGE_SIZE
+	static Region MapRegion(size_t size);
+	static void UnmapRegion(const Region& region) noexcept;
+};
@@ -1,5 +1,8 @@
 #include "process_queries.h"
 #include "search_server.h"
+#include "query_server.h"
+#include "query_client.h"
+#include "search_benchmark.h"
 
 #include <execution>
 #include <iostream>
@@ -8,9 +11,7 @@
 
 using namespace std;
 
-int main() {
-	SearchServer search_server("and with"s);
-
+void AddDemoDocuments(SearchServer& search_server) {
 	int id = 0;
 	for (
 		const string& text : {
@@ -50,6 +51,78 @@ int main() {
 		) {
 		search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, { 1, 2 });
 	}
+}
+
+// search-server serve tcp <port> | serve unix <path>
+int RunServe(const SearchServer& search_server, const string& transport, const string& address) {
+	QueryServer query_server(search_server);
+	if (transport == "unix"s) {
+		query_server.ListenUnix(address);
+	}
+	else {
+		query_server.ListenTcp(static_cast<uint16_t>(stoi(address)));
+	}
+	query_server.Run();
+	return 0;
+}
+
+// search-server load tcp <port> | load unix <path> [connections] [requests] [pipeline]
+int RunLoadGenerator(int argc, char* argv[]) {
+	LoadOptions options;
+	if (argv[2] == "unix"s) {
+		options.unix_path = argv[3];
+	}
+	else {
+		options.port = static_cast<uint16_t>(stoi(argv[3]));
+	}
+	if (argc > 4) {
+		options.connections = stoul(argv[4]);
+	}
+	if (argc > 5) {
+		options.requests_per_connection = stoul(argv[5]);
+	}
+	if (argc > 6) {
+		options.pipeline_depth = stoul(argv[6]);
+	}
+	const vector<string> queries = {
+		"If you can"s, "keep your head"s, "dream -master"s, "make one heap of all your winnings"s,
+		"talk with crowds -Kings"s, "unforgiving minute"s, "truth you’ve spoken"s, "Hold on"s,
+	};
+	cout << RunLoad(options, queries) << endl;
+	return 0;
+}
+
+// search-server bench [documents] [queries] [text|json] [heap|huge_pages]
+int RunBenchmark(int argc, char* argv[]) {
+	BenchmarkOptions options;
+	if (argc > 2) {
+		options.document_count = stoul(argv[2]);
+	}
+	if (argc > 3) {
+		options.query_count = stoul(argv[3]);
+	}
+	const StatsFormat format = argc > 4 && argv[4] == "json"s ? StatsFormat::JSON : StatsFormat::TEXT;
+	if (argc > 5 && argv[5] == "huge_pages"s) {
+		options.allocation = IndexAllocation::HUGE_PAGES;
+	}
+	WriteBenchmarkReport(cout, RunSearchBenchmarks(options), format);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc >= 4 && argv[1] == "load"s) {
+		return RunLoadGenerator(argc, argv);
+	}
+	if (argc >= 2 && argv[1] == "bench"s) {
+		return RunBenchmark(argc, argv);
+	}
+
+	SearchServer search_server("and with"s);
+	AddDemoDocuments(search_server);
+
+	if (argc >= 4 && argv[1] == "serve"s) {
+		return RunServe(search_server, argv[2], argv[3]);
+	}
 
 
 	cout << "ACTUAL by default, execution::seq:"s << endl;
@@ -68,9 +141,7 @@ int main() {
 	for (const Document& document
 		: search_server.FindTopDocuments(execution::par,
 			"If you can"s,
-			[](int document_id, DocumentStatus status, int rating) {
-				return document_id % 2 == 0;
-			}))
+			DocumentFilter::IdModulo(2, 0)))
 	{
 		PrintDocument(document);
 	}
@@ -0,0 +1,60 @@
+#include "memory_accounting.h"
+
+#include "index_arena.h"
+
+using namespace std;
+
+MemoryCounter::MemoryCounter(std::pmr::memory_resource* resource)
+	: resource_(resource)
+{
+}
+
+void* MemoryCounter::Allocate(size_t bytes)
+{
+	void* result = arena_ != nullptr ? arena_->Allocate(bytes)
+		: resource_ != nullptr ? resource_->allocate(bytes)
+		: ::operator new(bytes);
+	bytes_.fetch_add(bytes, memory_order_relaxed);
+	allocations_.fetch_add(1, memory_order_relaxed);
+	return result;
+}
+
+void MemoryCounter::Deallocate(void* pointer, size_t bytes) noexcept
+{
+	bytes_.fetch_sub(bytes, memory_order_relaxed);
+	allocations_.fetch_sub(1, memory_order_relaxed);
+	if (arena_ != nullptr) {
+		arena_->Deallocate(pointer, bytes);
+	}
+	else if (resource_ != nullptr) {
+		resource_->deallocate(pointer, bytes);
+	}
+	else {
+		::operator delete(pointer);
+	}
+}
+
+size_t MemoryCounter::Bytes() const
+{
+	return bytes_.load(memory_order_relaxed);
+}
+
+size_t MemoryCounter::Allocations() const
+{
+	return allocations_.load(memory_order_relaxed);
+}
+
+void MemoryCounter::SetArena(IndexArena* arena)
+{
+	arena_ = arena;
+}
+
+IndexArena* MemoryCounter::GetArena() const
+{
+	return arena_;
+}
+
+size_t MemoryStats::Total() const
+{
+	return document_texts + inverted_index + forward_index + documents;
+}
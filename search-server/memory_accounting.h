@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class IndexArena;
+
+// Счётчик памяти одной структуры индекса. Память берётся из арены
+// или ресурса, если они заданы, иначе из кучи
+class MemoryCounter {
+public:
+	MemoryCounter() = default;
+	// Временные структуры запроса размещаются в его арене (см. QueryArena)
+	explicit MemoryCounter(std::pmr::memory_resource* resource);
+
+	void* Allocate(size_t bytes);
+	void Deallocate(void* pointer, size_t bytes) noexcept;
+
+	size_t Bytes() const;
+	size_t Allocations() const;
+
+	// Задаётся до первого выделения; арена должна пережить все блоки
+	void SetArena(IndexArena* arena);
+	IndexArena* GetArena() const;
+
+private:
+	std::atomic<size_t> bytes_{ 0 };
+	std::atomic<size_t> allocations_{ 0 };
+	IndexArena* arena_ = nullptr;
+	std::pmr::memory_resource* resource_ = nullptr;
+};
+
+// Аллокатор, учитывающий каждый запрошенный у кучи байт в MemoryCounter,
+// включая узлы деревьев и служебные поля контейнеров
+template <typename T>
+class CountingAllocator {
+public:
+	using value_type = T;
+
+	explicit CountingAllocator(MemoryCounter* counter) noexcept
+		: counter_(counter) {
+	}
+
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U>& other) noexcept
+		: counter_(other.Counter()) {
+	}
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(counter_->Allocate(count * sizeof(T)));
+	}
+
+	void deallocate(T* pointer, size_t count) noexcept {
+		counter_->Deallocate(pointer, count * sizeof(T));
+	}
+
+	MemoryCounter* Counter() const noexcept {
+		return counter_;
+	}
+
+private:
+	MemoryCounter* counter_;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+	return lhs.Counter() == rhs.Counter();
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>& lhs, const CountingAllocator<U>& rhs) noexcept {
+	return !(lhs == rhs);
+}
+
+template <typename T>
+using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+// Оценка служебной памяти узла std::map/std::set сверх хранимого значения
+const size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+
+// Сколько байт дополнительно запросит вектор при добавлении count элементов.
+// Рост считается удвоением ёмкости — верхняя граница для распространённых реализаций
+template <typename Vector>
+size_t AppendCost(const Vector& vector, size_t count) {
+	const size_t required = vector.size() + count;
+	if (required <= vector.capacity()) {
+		return 0;
+	}
+	const size_t new_capacity = std::max(required, 2 * vector.capacity());
+	return (new_capacity - vector.capacity()) * sizeof(typename Vector::value_type);
+}
+
+struct MemoryStats {
+	size_t document_texts = 0;
+	size_t inverted_index = 0;
+	size_t forward_index = 0;
+	size_t documents = 0;
+	size_t budget = 0;
+	// Отображено ареной индекса (IndexAllocation::HUGE_PAGES), в том числе
+	// свободные блоки; в Total и бюджет не входит
+	size_t index_arena = 0;
+
+	size_t Total() const;
+};
+
+class MemoryBudgetExceeded : public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
@@ -0,0 +1,235 @@
+#include "near_duplicates.h"
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "execution_cost_model.h"
+#include "forward_index.h"
+
+using namespace std;
+
+namespace {
+
+	// Документ сравнивается только с оставленными документами своих корзин,
+	// и в корзине их хранится не больше этого числа. Иначе корзина, в которую
+	// попали разные документы, дала бы квадратичное число сравнений
+	const size_t MAX_BUCKET_REPRESENTATIVES = 8;
+
+	const uint32_t NO_BUCKET = numeric_limits<uint32_t>::max();
+
+	uint64_t Mix(uint64_t value) {
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	template <typename Iterator, typename Function>
+	void ForEach(bool parallel, Iterator first, Iterator last, Function function) {
+		if (parallel) {
+			for_each(execution::par, first, last, function);
+		}
+		else {
+			for_each(first, last, function);
+		}
+	}
+
+	template <typename Iterator>
+	void Sort(Iterator first, Iterator last) {
+		if (ExecutionCostModel::Instance().ShouldParallelize(SortWork(last - first))) {
+			sort(execution::par, first, last);
+		}
+		else {
+			sort(first, last);
+		}
+	}
+
+	// Слова в WordFrequencies отсортированы, поэтому пересечение — слиянием
+	double ComputeJaccardSimilarity(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+		size_t common = 0;
+		auto left = lhs.begin();
+		auto right = rhs.begin();
+		while (left != lhs.end() && right != rhs.end()) {
+			if (left->first < right->first) {
+				++left;
+			}
+			else if (right->first < left->first) {
+				++right;
+			}
+			else {
+				++common;
+				++left;
+				++right;
+			}
+		}
+		return static_cast<double>(common) / static_cast<double>(lhs.size() + rhs.size() - common);
+	}
+
+}
+
+vector<NearDuplicate> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options)
+{
+	if (options.hash_count == 0 || options.band_count == 0 || options.hash_count % options.band_count != 0) {
+		throw invalid_argument("Hash count must be a positive multiple of band count"s);
+	}
+	if (!(options.min_similarity > 0.0 && options.min_similarity <= 1.0)) {
+		throw invalid_argument("Minimal similarity must be in (0, 1]"s);
+	}
+	const size_t hash_count = options.hash_count;
+	const size_t band_count = options.band_count;
+	const size_t rows = hash_count / band_count;
+
+	vector<int> ids(search_server.begin(), search_server.end());
+	sort(ids.begin(), ids.end());
+	if (ids.size() > numeric_limits<uint32_t>::max()) {
+		throw length_error("Too many documents"s);
+	}
+	const bool parallel = ExecutionCostModel::Instance().ShouldParallelize(ids.size() * hash_count);
+
+	// Хеш-функции подписи: h * multiplier + increment с нечётным множителем
+	vector<uint64_t> multipliers(hash_count);
+	vector<uint64_t> increments(hash_count);
+	uint64_t state = options.seed;
+	for (size_t k = 0; k < hash_count; ++k) {
+		multipliers[k] = Mix(state += 0x9E3779B97F4A7C15ull) | 1;
+		increments[k] = Mix(state += 0x9E3779B97F4A7C15ull);
+	}
+
+	// Подпись документа нужна только для ключей полос, поэтому не хранится.
+	// Документы без слов не сравниваются
+	// Параллельный алгоритм может передать копию элемента, поэтому
+	// документы обходятся по номерам, а не по адресам в ids
+	vector<WordFrequencies> document_words(ids.size());
+	vector<uint32_t> band_keys(ids.size() * band_count);
+	vector<uint32_t> indices(ids.size());
+	iota(indices.begin(), indices.end(), 0);
+	ForEach(parallel, indices.begin(), indices.end(), [&](uint32_t index) {
+		const WordFrequencies words = search_server.GetWordFrequencies(ids[index]);
+		document_words[index] = words;
+		if (words.empty()) {
+			return;
+		}
+		thread_local vector<uint64_t> signature;
+		signature.assign(hash_count, numeric_limits<uint64_t>::max());
+		for (const auto& [word, _] : words) {
+			const uint64_t word_hash = hash<string_view>{}(word);
+			for (size_t k = 0; k < hash_count; ++k) {
+				signature[k] = min(signature[k], word_hash * multipliers[k] + increments[k]);
+			}
+		}
+		for (size_t band = 0; band < band_count; ++band) {
+			uint64_t key = 0;
+			for (size_t row = 0; row < rows; ++row) {
+				key = Mix(key ^ signature[band * rows + row]);
+			}
+			band_keys[index * band_count + band] = static_cast<uint32_t>(key >> 32);
+		}
+		});
+
+	// Корзина — документы с совпавшей полосой. Для каждой корзины из двух
+	// и более документов отводится место под её оставленные документы
+	vector<uint32_t> document_buckets(ids.size() * band_count, NO_BUCKET);
+	vector<size_t> representative_offsets = { 0 };
+	vector<pair<uint32_t, uint32_t>> buckets;
+	buckets.reserve(ids.size());
+	for (size_t band = 0; band < band_count; ++band) {
+		buckets.clear();
+		for (uint32_t index = 0; index < ids.size(); ++index) {
+			if (!document_words[index].empty()) {
+				buckets.push_back({ band_keys[index * band_count + band], index });
+			}
+		}
+		Sort(buckets.begin(), buckets.end());
+		for (size_t first = 0; first < buckets.size();) {
+			size_t last = first + 1;
+			while (last < buckets.size() && buckets[last].first == buckets[first].first) {
+				++last;
+			}
+			if (last - first > 1) {
+				if (representative_offsets.size() > NO_BUCKET) {
+					throw length_error("Too many buckets"s);
+				}
+				const uint32_t bucket = static_cast<uint32_t>(representative_offsets.size() - 1);
+				for (size_t i = first; i < last; ++i) {
+					document_buckets[buckets[i].second * band_count + band] = bucket;
+				}
+				representative_offsets.push_back(representative_offsets.back() + min(last - first, MAX_BUCKET_REPRESENTATIVES));
+			}
+			first = last;
+		}
+	}
+	vector<uint32_t> representatives(representative_offsets.back());
+	vector<uint32_t> representative_counts(representative_offsets.size() - 1, 0);
+
+	// Документы в порядке id: дубликат похож на ранний документ, который остаётся.
+	// К моменту обработки документа судьба всех ранних уже решена, и оставленные
+	// попали в свои корзины, поэтому группа одинаковых документов любого размера
+	// сводится к первому. Оставленный документ сравнивается один раз, даже если
+	// он делит с документом несколько корзин
+	vector<uint32_t> compared_with(ids.size(), NO_BUCKET);
+	vector<NearDuplicate> duplicates;
+	for (uint32_t index = 0; index < ids.size(); ++index) {
+		const WordFrequencies& words = document_words[index];
+		if (words.empty()) {
+			continue;
+		}
+		NearDuplicate duplicate{ ids[index], 0, 0.0 };
+		for (size_t band = 0; band < band_count; ++band) {
+			const uint32_t bucket = document_buckets[index * band_count + band];
+			if (bucket == NO_BUCKET) {
+				continue;
+			}
+			const uint32_t* bucket_representatives = representatives.data() + representative_offsets[bucket];
+			for (size_t r = 0; r < representative_counts[bucket]; ++r) {
+				const uint32_t original = bucket_representatives[r];
+				if (compared_with[original] == index) {
+					continue;
+				}
+				compared_with[original] = index;
+				const WordFrequencies& original_words = document_words[original];
+				// Похожесть не больше отношения размеров, слияние тогда не нужно
+				const double smaller = static_cast<double>(min(words.size(), original_words.size()));
+				const double larger = static_cast<double>(max(words.size(), original_words.size()));
+				if (smaller < options.min_similarity * larger) {
+					continue;
+				}
+				// При равной похожести оригинал — документ с меньшим id
+				const double similarity = ComputeJaccardSimilarity(words, original_words);
+				if (similarity >= options.min_similarity && (similarity > duplicate.similarity
+					|| (similarity == duplicate.similarity && ids[original] < duplicate.original_id))) {
+					duplicate.original_id = ids[original];
+					duplicate.similarity = similarity;
+				}
+			}
+		}
+		if (duplicate.similarity > 0.0) {
+			duplicates.push_back(duplicate);
+			continue;
+		}
+		for (size_t band = 0; band < band_count; ++band) {
+			const uint32_t bucket = document_buckets[index * band_count + band];
+			if (bucket != NO_BUCKET && representative_offsets[bucket] + representative_counts[bucket] < representative_offsets[bucket + 1]) {
+				representatives[representative_offsets[bucket] + representative_counts[bucket]++] = index;
+			}
+		}
+	}
+	return duplicates;
+}
+
+vector<NearDuplicate> RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options)
+{
+	vector<NearDuplicate> duplicates = FindNearDuplicates(search_server, options);
+	vector<int> document_ids;
+	document_ids.reserve(duplicates.size());
+	for (const NearDuplicate& duplicate : duplicates) {
+		document_ids.push_back(duplicate.document_id);
+	}
+	search_server.RemoveDocuments(document_ids);
+	return duplicates;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "search_server.h"
+
+// Параметры поиска почти одинаковых документов. Подпись MinHash из
+// hash_count значений делится на band_count полос; документы с совпавшей
+// полосой становятся кандидатами и сравниваются точно. Пара с похожестью s
+// попадает в кандидаты с вероятностью 1 - (1 - s^r)^b, r = hash_count / band_count
+struct NearDuplicateOptions {
+	size_t hash_count = 128;
+	size_t band_count = 32;
+	// Минимальный коэффициент Жаккара множеств слов документов
+	double min_similarity = 0.8;
+	uint64_t seed = 0;
+};
+
+struct NearDuplicate {
+	int document_id;
+	// Оставляемый документ с меньшим id, на который похож document_id
+	int original_id;
+	double similarity;
+};
+
+// Документы, похожие на документ с меньшим id, который сам не дубликат.
+// Подписи считаются параллельно, время почти линейно по числу документов.
+// Результат упорядочен по document_id
+std::vector<NearDuplicate> FindNearDuplicates(
+	const SearchServer& search_server,
+	const NearDuplicateOptions& options = {});
+
+// Удаляет найденные FindNearDuplicates документы одним пакетом RemoveDocuments
+std::vector<NearDuplicate> RemoveNearDuplicates(
+	SearchServer& search_server,
+	const NearDuplicateOptions& options = {});
@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+
+#include "document.h"
+#include "paginator.h"
+#include "search_server.h"
+
+// Ленивый обход всей выдачи по страницам: каждая следующая страница
+// запрашивается курсором от последнего документа предыдущей, поэтому
+// в памяти находится только текущая страница
+template <typename DocumentPredicate>
+class PagedSearch {
+public:
+    using Page = IteratorRange<std::vector<Document>::const_iterator>;
+
+    class PageIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Page;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Page;
+
+        PageIterator() = default;
+
+        explicit PageIterator(const PagedSearch* search)
+            : search_(search)
+            , page_(search->server_.FindTopDocumentsPage(search->raw_query_, 0, search->page_size_, search->document_predicate_)) {
+            if (page_.empty()) {
+                search_ = nullptr;
+            }
+        }
+
+        Page operator*() const {
+            return { page_.begin(), page_.end() };
+        }
+
+        PageIterator& operator++() {
+            // Неполная страница — последняя
+            if (page_.size() < search_->page_size_) {
+                search_ = nullptr;
+                page_.clear();
+                return *this;
+            }
+            page_ = search_->server_.FindTopDocumentsAfter(search_->raw_query_, page_.back(), search_->page_size_, search_->document_predicate_);
+            if (page_.empty()) {
+                search_ = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return search_ == nullptr && other.search_ == nullptr;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const PagedSearch* search_ = nullptr;
+        std::vector<Document> page_;
+    };
+
+    PagedSearch(const SearchServer& server, std::string_view raw_query, size_t page_size, DocumentPredicate document_predicate)
+        : server_(server)
+        , raw_query_(raw_query)
+        , page_size_(page_size)
+        , document_predicate_(document_predicate) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive");
+        }
+    }
+
+    PageIterator begin() const {
+        return PageIterator(this);
+    }
+
+    PageIterator end() const {
+        return {};
+    }
+
+private:
+    const SearchServer& server_;
+    std::string raw_query_;
+    size_t page_size_;
+    DocumentPredicate document_predicate_;
+};
+
+template <typename DocumentPredicate>
+auto PaginateSearch(const SearchServer& server, std::string_view raw_query, size_t page_size, DocumentPredicate document_predicate) {
+    return PagedSearch<DocumentPredicate>(server, raw_query, page_size, document_predicate);
+}
+
+inline auto PaginateSearch(const SearchServer& server, std::string_view raw_query, size_t page_size, DocumentStatus status = DocumentStatus::ACTUAL) {
+    return PaginateSearch(server, raw_query, page_size, DocumentFilter::Status(status));
+}
@@ -1,8 +1,8 @@
 #pragma once
-#include <vector>
+#include <algorithm>
 #include <iterator>
-#include <ostream>
 #include <cassert>
+#include <cstddef>
 
 template <typename Iterator>
 class IteratorRange {
@@ -10,7 +10,7 @@ public:
     IteratorRange(Iterator begin, Iterator end)
         : first_(begin)
         , last_(end)
-        , size_(distance(first_, last_)) {
+        , size_(std::distance(first_, last_)) {
     }
 
     Iterator begin() const {
@@ -31,38 +31,83 @@ private:
 };
 
 
+// Ленивое представление: страницы не хранятся, а вычисляются при обходе
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        std::assert(end >= begin && page_size > 0);
-        for (size_t left = std::distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = std::next(begin, current_page_size);
-            pages_.push_back({ begin, current_page_end });
-
-            left -= current_page_size;
-            begin = current_page_end;
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        PageIterator(Iterator first, Iterator last, size_t page_size)
+            : first_(first)
+            , last_(last)
+            , page_size_(page_size) {
+        }
+
+        value_type operator*() const {
+            return { first_, PageEnd() };
+        }
+
+        PageIterator& operator++() {
+            first_ = PageEnd();
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return first_ == other.first_;
         }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator first_, last_;
+        size_t page_size_;
+
+        Iterator PageEnd() const {
+            const size_t left = std::distance(first_, last_);
+            return std::next(first_, std::min(page_size_, left));
+        }
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : first_(begin)
+        , last_(end)
+        , page_size_(page_size) {
+        assert(page_size > 0);
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return { first_, last_, page_size_ };
     }
 
-    auto end() const {
-        return pages_.end();
+    PageIterator end() const {
+        return { last_, last_, page_size_ };
     }
 
     size_t size() const {
-        return pages_.size();
+        const size_t count = std::distance(first_, last_);
+        return (count + page_size_ - 1) / page_size_;
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator first_, last_;
+    size_t page_size_;
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
-}
\ No newline at end of file
+}
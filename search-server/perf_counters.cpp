@@ -0,0 +1,179 @@
+#include "perf_counters.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+	using Reading = PerfCounters::Reading;
+
+#ifdef __linux__
+	int OpenEvent(PerfEvent event) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		switch (event) {
+		case PerfEvent::CYCLES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfEvent::INSTRUCTIONS:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfEvent::LLC_MISSES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		case PerfEvent::BRANCH_MISSES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		case PerfEvent::CONTEXT_SWITCHES:
+			// Переключения происходят в ядре, поэтому без exclude_kernel
+			attr.type = PERF_TYPE_SOFTWARE;
+			attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+			attr.exclude_kernel = 0;
+			break;
+		}
+		const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fd < 0 && attr.exclude_kernel == 0) {
+			attr.exclude_kernel = 1;
+			return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+		return static_cast<int>(fd);
+	}
+
+	Reading ReadEvent(int fd) {
+		Reading reading;
+		uint64_t buffer[3];
+		if (read(fd, buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer))) {
+			reading = { buffer[0], buffer[1], buffer[2] };
+		}
+		return reading;
+	}
+#else
+	int OpenEvent(PerfEvent) {
+		return -1;
+	}
+
+	Reading ReadEvent(int) {
+		return {};
+	}
+#endif
+
+}
+
+std::string_view GetPerfEventName(PerfEvent event)
+{
+	switch (event) {
+	case PerfEvent::CYCLES:
+		return "cycles"sv;
+	case PerfEvent::INSTRUCTIONS:
+		return "instructions"sv;
+	case PerfEvent::LLC_MISSES:
+		return "llc_misses"sv;
+	case PerfEvent::BRANCH_MISSES:
+		return "branch_misses"sv;
+	case PerfEvent::CONTEXT_SWITCHES:
+		return "context_switches"sv;
+	}
+	return "unknown"sv;
+}
+
+uint64_t PerfSample::Get(PerfEvent event) const
+{
+	return values[static_cast<size_t>(event)];
+}
+
+bool PerfSample::IsAvailable(PerfEvent event) const
+{
+	return available[static_cast<size_t>(event)];
+}
+
+PerfSample& PerfSample::operator+=(const PerfSample& other)
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+		values[i] += other.values[i];
+		available[i] = available[i] && other.available[i];
+	}
+	nanoseconds += other.nanoseconds;
+	return *this;
+}
+
+PerfCounters::PerfCounters()
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+		fds_[i] = OpenEvent(static_cast<PerfEvent>(i));
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for (const int fd : fds_) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+#endif
+}
+
+bool PerfCounters::IsAvailable(PerfEvent event) const
+{
+	return fds_[static_cast<size_t>(event)] >= 0;
+}
+
+bool PerfCounters::IsAnyAvailable() const
+{
+	for (const int fd : fds_) {
+		if (fd >= 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Счётчики включены с открытия, интервал — разность показаний
+void PerfCounters::Start()
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (fds_[i] >= 0) {
+			start_readings_[i] = ReadEvent(fds_[i]);
+		}
+	}
+	start_ = chrono::steady_clock::now();
+}
+
+PerfSample PerfCounters::Stop()
+{
+	const auto finish = chrono::steady_clock::now();
+	PerfSample sample;
+	sample.nanoseconds = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(finish - start_).count());
+	for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (fds_[i] < 0) {
+			continue;
+		}
+		const Reading reading = ReadEvent(fds_[i]);
+		const uint64_t value = reading.value - start_readings_[i].value;
+		const uint64_t enabled = reading.time_enabled - start_readings_[i].time_enabled;
+		const uint64_t running = reading.time_running - start_readings_[i].time_running;
+		sample.available[i] = true;
+		// Когда счётчиков больше, чем регистров PMU, ядро включает их по очереди,
+		// и показание масштабируется на долю времени, когда счётчик работал
+		sample.values[i] = running == 0 || running == enabled
+			? value
+			: static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+	}
+	return sample;
+}
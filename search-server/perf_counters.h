@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+enum class PerfEvent {
+	CYCLES,
+	INSTRUCTIONS,
+	LLC_MISSES,
+	BRANCH_MISSES,
+	CONTEXT_SWITCHES,
+};
+
+const size_t PERF_EVENT_COUNT = 5;
+
+std::string_view GetPerfEventName(PerfEvent event);
+
+// Показания счётчиков за интервал. Недоступный счётчик не считается
+// и помечается в available, время измеряется всегда
+struct PerfSample {
+	std::array<uint64_t, PERF_EVENT_COUNT> values{};
+	std::array<bool, PERF_EVENT_COUNT> available{};
+	uint64_t nanoseconds = 0;
+
+	uint64_t Get(PerfEvent event) const;
+	bool IsAvailable(PerfEvent event) const;
+
+	// Доступность — пересечение доступности слагаемых
+	PerfSample& operator+=(const PerfSample& other);
+};
+
+// Аппаратные и программные счётчики вызывающего потока через perf_event_open
+// (только пользовательский режим, поэтому хватает perf_event_paranoid <= 2).
+// Каждый счётчик открывается отдельно: без прав, в виртуальной машине без PMU
+// или не в Linux недоступны только отдельные счётчики, а не вся группа.
+// Работа потоков пула в параллельных алгоритмах не учитывается
+class PerfCounters {
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool IsAvailable(PerfEvent event) const;
+	bool IsAnyAvailable() const;
+
+	void Start();
+	PerfSample Stop();
+
+	// Показания за один вызов function
+	template <typename Function>
+	PerfSample Measure(Function function);
+
+	// Показание счётчика с временем, когда он был включён и действительно считал
+	struct Reading {
+		uint64_t value = 0;
+		uint64_t time_enabled = 0;
+		uint64_t time_running = 0;
+	};
+
+private:
+	std::array<int, PERF_EVENT_COUNT> fds_;
+	std::array<Reading, PERF_EVENT_COUNT> start_readings_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+template <typename Function>
+PerfSample PerfCounters::Measure(Function function)
+{
+	Start();
+	function();
+	return Stop();
+}
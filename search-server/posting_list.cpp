@@ -0,0 +1,174 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PostingList::PostingList(MemoryCounter* counter)
+	: slots_(CountingAllocator<uint32_t>(counter))
+	, term_freqs_(CountingAllocator<double>(counter))
+	, impact_slots_(CountingAllocator<uint32_t>(counter))
+	, impact_term_freqs_(CountingAllocator<double>(counter))
+{
+}
+
+void PostingList::Add(uint32_t slot, double term_freq)
+{
+	// Слоты выдаются по возрастанию, поэтому обычно это вставка в конец
+	const size_t position = (slots_.empty() || slots_.back() < slot) ? slots_.size() : LowerBound(slot);
+	slots_.insert(slots_.begin() + position, slot);
+	term_freqs_.insert(term_freqs_.begin() + position, term_freq);
+
+	if (impact_ordered_) {
+		const size_t impact_position = ImpactLowerBound(slot, term_freq);
+		impact_slots_.insert(impact_slots_.begin() + impact_position, slot);
+		impact_term_freqs_.insert(impact_term_freqs_.begin() + impact_position, term_freq);
+	}
+}
+
+void PostingList::MarkRemoved()
+{
+	++removed_count_;
+}
+
+size_t PostingList::size() const
+{
+	return slots_.size();
+}
+
+bool PostingList::empty() const
+{
+	return slots_.empty();
+}
+
+size_t PostingList::GetDocumentCount() const
+{
+	return slots_.size() - removed_count_;
+}
+
+const uint32_t* PostingList::Slots() const
+{
+	return slots_.data();
+}
+
+const double* PostingList::TermFreqs() const
+{
+	return term_freqs_.data();
+}
+
+size_t PostingList::LowerBound(uint32_t slot) const
+{
+	return lower_bound(slots_.begin(), slots_.end(), slot) - slots_.begin();
+}
+
+bool PostingList::Contains(uint32_t slot) const
+{
+	const size_t position = LowerBound(slot);
+	return position < slots_.size() && slots_[position] == slot;
+}
+
+void PostingList::SetImpactOrdered(bool enabled)
+{
+	impact_ordered_ = enabled;
+	impact_slots_.clear();
+	impact_term_freqs_.clear();
+	if (!enabled) {
+		impact_slots_.shrink_to_fit();
+		impact_term_freqs_.shrink_to_fit();
+		return;
+	}
+
+	// Порядок строится прямо в impact_slots_ позициями вхождений: дополнительной
+	// памяти не нужно, и объединённые списки запроса не выходят из его арены.
+	// Позиции возрастают вместе со слотами, поэтому при равной частоте
+	// сохраняется порядок слотов
+	impact_slots_.resize(slots_.size());
+	for (size_t i = 0; i < impact_slots_.size(); ++i) {
+		impact_slots_[i] = static_cast<uint32_t>(i);
+	}
+	sort(impact_slots_.begin(), impact_slots_.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return term_freqs_[lhs] > term_freqs_[rhs] || (term_freqs_[lhs] == term_freqs_[rhs] && lhs < rhs);
+		});
+	impact_term_freqs_.resize(impact_slots_.size());
+	for (size_t i = 0; i < impact_slots_.size(); ++i) {
+		impact_term_freqs_[i] = term_freqs_[impact_slots_[i]];
+		impact_slots_[i] = slots_[impact_slots_[i]];
+	}
+}
+
+bool PostingList::IsImpactOrdered() const
+{
+	return impact_ordered_;
+}
+
+const uint32_t* PostingList::ImpactSlots() const
+{
+	return impact_slots_.data();
+}
+
+const double* PostingList::ImpactTermFreqs() const
+{
+	return impact_term_freqs_.data();
+}
+
+size_t PostingList::ImpactLowerBound(uint32_t slot, double term_freq) const
+{
+	size_t first = 0;
+	size_t count = impact_slots_.size();
+	while (count > 0) {
+		const size_t step = count / 2;
+		const size_t middle = first + step;
+		const bool before = impact_term_freqs_[middle] > term_freq
+			|| (impact_term_freqs_[middle] == term_freq && impact_slots_[middle] < slot);
+		if (before) {
+			first = middle + 1;
+			count -= step + 1;
+		}
+		else {
+			count = step;
+		}
+	}
+	return first;
+}
+
+void PostingList::Renumber(const std::vector<uint32_t>& new_slots)
+{
+	vector<pair<uint32_t, double>> postings;
+	postings.reserve(slots_.size() - removed_count_);
+	for (size_t i = 0; i < slots_.size(); ++i) {
+		if (new_slots[slots_[i]] != NO_SLOT) {
+			postings.push_back({ new_slots[slots_[i]], term_freqs_[i] });
+		}
+	}
+	// Сжатие без перестановки сохраняет порядок слотов
+	if (!is_sorted(postings.begin(), postings.end())) {
+		sort(postings.begin(), postings.end());
+	}
+	slots_.resize(postings.size());
+	term_freqs_.resize(postings.size());
+	for (size_t i = 0; i < postings.size(); ++i) {
+		slots_[i] = postings[i].first;
+		term_freqs_[i] = postings[i].second;
+	}
+	removed_count_ = 0;
+	if (impact_ordered_) {
+		SetImpactOrdered(true);
+	}
+}
+
+size_t PostingList::AppendCost() const
+{
+	size_t cost = ::AppendCost(slots_, 1) + ::AppendCost(term_freqs_, 1);
+	if (impact_ordered_) {
+		cost += ::AppendCost(impact_slots_, 1) + ::AppendCost(impact_term_freqs_, 1);
+	}
+	return cost;
+}
+
+void PostingList::ShrinkToFit()
+{
+	slots_.shrink_to_fit();
+	term_freqs_.shrink_to_fit();
+	impact_slots_.shrink_to_fit();
+	impact_term_freqs_.shrink_to_fit();
+}
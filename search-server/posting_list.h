@@ -0,0 +1,70 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_accounting.h"
+
+// Порядок вхождений в индексе. В IMPACT_ORDERED каждый список дополнительно
+// хранит копию вхождений по убыванию частоты слова для досрочного
+// завершения поиска (см. SearchServer::SetIndexLayout)
+enum class IndexLayout {
+	DOCUMENT_ORDERED,
+	IMPACT_ORDERED,
+};
+
+// Список вхождений слова: номера слотов документов по возрастанию
+// и частоты слова в них, хранящиеся в отдельных массивах для векторного обхода.
+// Удаление ленивое, как в ForwardIndex: вхождение удалённого документа остаётся
+// в списке, пока слоты не перенумерует Renumber, а его слот освобождается
+// в DocumentAttributes, и поиск такие слоты пропускает
+class PostingList {
+public:
+	// Слот, вхождения которого Renumber отбрасывает
+	static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+	explicit PostingList(MemoryCounter* counter);
+
+	void Add(uint32_t slot, double term_freq);
+	// Учитывает удаление документа со словом за O(1)
+	void MarkRemoved();
+
+	// Число вхождений вместе с удалёнными — длина массивов Slots() и TermFreqs()
+	size_t size() const;
+	bool empty() const;
+	// Число документов со словом без удалённых
+	size_t GetDocumentCount() const;
+
+	const uint32_t* Slots() const;
+	const double* TermFreqs() const;
+
+	// Первая позиция со слотом не меньше slot
+	size_t LowerBound(uint32_t slot) const;
+	bool Contains(uint32_t slot) const;
+
+	// Упорядочение по частоте: по убыванию частоты, при равенстве по слоту
+	void SetImpactOrdered(bool enabled);
+	bool IsImpactOrdered() const;
+	const uint32_t* ImpactSlots() const;
+	const double* ImpactTermFreqs() const;
+
+	// Слот s становится new_slots[s], вхождения слотов с NO_SLOT отбрасываются;
+	// порядок восстанавливается
+	void Renumber(const std::vector<uint32_t>& new_slots);
+
+	// Дополнительная память под ещё одно вхождение
+	size_t AppendCost() const;
+	void ShrinkToFit();
+
+private:
+	CountedVector<uint32_t> slots_;
+	CountedVector<double> term_freqs_;
+	bool impact_ordered_ = false;
+	CountedVector<uint32_t> impact_slots_;
+	CountedVector<double> impact_term_freqs_;
+	size_t removed_count_ = 0;
+
+	size_t ImpactLowerBound(uint32_t slot, double term_freq) const;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+// На сколько элементов вперёд циклы по слотам документов предвыбирают
+// данные, к которым обращаются по слоту: накопители релевантности и атрибуты.
+// Сами списки вхождений читаются подряд и предвыбираются процессором
+const size_t PREFETCH_DISTANCE = 16;
+
+// Подсказка процессору; адрес не разыменовывается и может быть любым
+inline void PrefetchForRead(const void* address) {
+#ifdef __GNUC__
+	__builtin_prefetch(address, 0, 3);
+#endif
+}
+
+inline void PrefetchForWrite(const void* address) {
+#ifdef __GNUC__
+	__builtin_prefetch(address, 1, 3);
+#endif
+}
@@ -2,8 +2,11 @@
 
 using namespace std;
 
-vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries)
+vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries, QueryBatchMode mode)
 {
+	if (mode == QueryBatchMode::SHARED_SCAN) {
+		return search_server.FindTopDocumentsBatch(queries);
+	}
 	vector<vector<Document>> result(queries.size());
 	transform(execution::par,
 		queries.begin(), queries.end(),
@@ -15,10 +18,10 @@ vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const
 	return result;
 }
 
-list<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries)
+list<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries, QueryBatchMode mode)
 {
 	list<Document> result;
-	vector<vector<Document>> documents_query(ProcessQueries(search_server, queries));
+	vector<vector<Document>> documents_query(ProcessQueries(search_server, queries, mode));
 	for (vector<Document>& documents : documents_query) {
 		for (Document doc : documents) {
 			result.push_back(move(doc));
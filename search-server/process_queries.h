@@ -9,10 +9,20 @@
 #include "document.h"
 #include "search_server.h"
 
+// PER_QUERY — запросы выполняются независимо и параллельно,
+// SHARED_SCAN — пакетно, с однократным чтением списков вхождений
+// (см. SearchServer::FindTopDocumentsBatch). Результаты совпадают
+enum class QueryBatchMode {
+    PER_QUERY,
+    SHARED_SCAN,
+};
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
+    const std::vector<std::string>& queries,
+    QueryBatchMode mode = QueryBatchMode::PER_QUERY);
 
 std::list<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries,
+    QueryBatchMode mode = QueryBatchMode::PER_QUERY);
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "query_arena.h"
+
+#include <algorithm>
+
+using namespace std;
+
+QueryArena::Scope::Scope()
+	: arena_(QueryArena::ForThread())
+{
+	++arena_.depth_;
+}
+
+QueryArena::Scope::~Scope()
+{
+	if (--arena_.depth_ == 0) {
+		arena_.Reset();
+	}
+}
+
+std::pmr::memory_resource* QueryArena::Scope::Resource() const
+{
+	return &*arena_.resource_;
+}
+
+QueryArena& QueryArena::ForThread()
+{
+	thread_local QueryArena arena;
+	return arena;
+}
+
+size_t QueryArena::GetCapacity() const
+{
+	return capacity_;
+}
+
+size_t QueryArena::GetOverflowCount() const
+{
+	return overflow_count_;
+}
+
+QueryArena::QueryArena()
+{
+	Allocate(INITIAL_CAPACITY);
+}
+
+void QueryArena::Reset()
+{
+	resource_->release();
+	if (overflow_.Bytes() > 0) {
+		++overflow_count_;
+		const size_t capacity = min(2 * (capacity_ + overflow_.Bytes()), MAX_RETAINED_CAPACITY);
+		if (capacity > capacity_) {
+			Allocate(capacity);
+		}
+		else {
+			overflow_.Clear();
+		}
+	}
+}
+
+void QueryArena::Allocate(size_t capacity)
+{
+	resource_.reset();
+	overflow_.Clear();
+	buffer_.reset(new std::byte[capacity]);
+	capacity_ = capacity;
+	resource_.emplace(buffer_.get(), capacity_, &overflow_);
+}
+
+size_t QueryArena::Overflow::Bytes() const
+{
+	return bytes_;
+}
+
+void QueryArena::Overflow::Clear()
+{
+	bytes_ = 0;
+}
+
+void* QueryArena::Overflow::do_allocate(size_t bytes, size_t alignment)
+{
+	bytes_ += bytes;
+	return pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::Overflow::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+	pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+bool QueryArena::Overflow::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
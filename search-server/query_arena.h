@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <cstddef>
+
+// Арена временных данных запроса: монотонный ресурс поверх буфера потока.
+// Всё выделенное освобождается разом при выходе из внешней области Scope.
+// Если запросу не хватило буфера, к следующему запросу буфер увеличивается,
+// поэтому в установившемся режиме запросы не обращаются к общей куче.
+// Буфер растёт не больше MAX_RETAINED_CAPACITY: один огромный запрос не должен
+// навсегда занять столько же памяти в каждом потоке, где он выполнялся,
+// а такие запросы и дальше берут недостающее из кучи
+class QueryArena {
+public:
+	static constexpr size_t MAX_RETAINED_CAPACITY = 16 * 1024 * 1024;
+
+	// Вложенные области используют арену внешней
+	class Scope {
+	public:
+		Scope();
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		std::pmr::memory_resource* Resource() const;
+
+	private:
+		QueryArena& arena_;
+	};
+
+	static QueryArena& ForThread();
+
+	size_t GetCapacity() const;
+	// Сколько раз буфера не хватило и пришлось обращаться к куче
+	size_t GetOverflowCount() const;
+
+private:
+	// Запросы сверх буфера: учитываются, чтобы вырасти к следующему запросу
+	class Overflow : public std::pmr::memory_resource {
+	public:
+		size_t Bytes() const;
+		void Clear();
+
+	private:
+		size_t bytes_ = 0;
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+	};
+
+	static const size_t INITIAL_CAPACITY = 64 * 1024;
+
+	Overflow overflow_;
+	std::unique_ptr<std::byte[]> buffer_;
+	size_t capacity_ = 0;
+	size_t overflow_count_ = 0;
+	std::optional<std::pmr::monotonic_buffer_resource> resource_;
+	size_t depth_ = 0;
+
+	QueryArena();
+
+	void Reset();
+	void Allocate(size_t capacity);
+};
@@ -0,0 +1,225 @@
+#include "query_client.h"
+#include "query_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+	using Clock = chrono::steady_clock;
+
+	[[noreturn]] void ThrowSystemError(const string& what) {
+		throw system_error(errno, generic_category(), what);
+	}
+
+	int Connect(const LoadOptions& options) {
+		int fd;
+		if (!options.unix_path.empty()) {
+			sockaddr_un address{};
+			if (options.unix_path.size() >= sizeof(address.sun_path)) {
+				throw invalid_argument("Unix socket path is too long"s);
+			}
+			address.sun_family = AF_UNIX;
+			copy(options.unix_path.begin(), options.unix_path.end(), address.sun_path);
+			fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0) {
+				ThrowSystemError("socket"s);
+			}
+			if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+				close(fd);
+				ThrowSystemError("connect unix"s);
+			}
+		}
+		else {
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(options.port);
+			if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+				throw invalid_argument("Invalid host "s + options.host);
+			}
+			fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0) {
+				ThrowSystemError("socket"s);
+			}
+			if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+				close(fd);
+				ThrowSystemError("connect tcp"s);
+			}
+			const int enable = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		}
+		return fd;
+	}
+
+	void SendAll(int fd, const char* data, size_t size) {
+		while (size > 0) {
+			const ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				ThrowSystemError("send"s);
+			}
+			data += written;
+			size -= written;
+		}
+	}
+
+	void ReceiveAll(int fd, char* data, size_t size) {
+		while (size > 0) {
+			const ssize_t received = recv(fd, data, size, 0);
+			if (received <= 0) {
+				if (received < 0 && errno == EINTR) {
+					continue;
+				}
+				throw runtime_error("Connection closed by server"s);
+			}
+			data += received;
+			size -= received;
+		}
+	}
+
+	string MakeFrame(const string& query) {
+		const uint32_t length = static_cast<uint32_t>(query.size());
+		string frame(reinterpret_cast<const char*>(&length), sizeof(length));
+		frame += query;
+		return frame;
+	}
+
+	// Возвращает false, если сервер сообщил о некорректном запросе
+	bool ReceiveResponse(int fd, vector<WireDocument>& documents) {
+		int32_t count;
+		ReceiveAll(fd, reinterpret_cast<char*>(&count), sizeof(count));
+		if (count == QUERY_ERROR_RESPONSE) {
+			return false;
+		}
+		documents.resize(count);
+		ReceiveAll(fd, reinterpret_cast<char*>(documents.data()), count * sizeof(WireDocument));
+		return true;
+	}
+
+	struct ConnectionResult {
+		vector<double> latencies;
+		size_t errors = 0;
+	};
+
+	ConnectionResult RunConnection(const LoadOptions& options, const vector<string>& frames, size_t first_query) {
+		ConnectionResult result;
+		result.latencies.reserve(options.requests_per_connection);
+
+		const int fd = Connect(options);
+		deque<Clock::time_point> in_flight;
+		vector<WireDocument> documents;
+		size_t sent = 0;
+		size_t next_query = first_query;
+
+		while (result.latencies.size() < options.requests_per_connection) {
+			while (sent < options.requests_per_connection && in_flight.size() < options.pipeline_depth) {
+				const string& frame = frames[next_query++ % frames.size()];
+				in_flight.push_back(Clock::now());
+				SendAll(fd, frame.data(), frame.size());
+				++sent;
+			}
+			if (!ReceiveResponse(fd, documents)) {
+				++result.errors;
+			}
+			const chrono::duration<double, micro> latency = Clock::now() - in_flight.front();
+			in_flight.pop_front();
+			result.latencies.push_back(latency.count());
+		}
+		close(fd);
+		return result;
+	}
+
+	double Percentile(const vector<double>& sorted, double fraction) {
+		if (sorted.empty()) {
+			return 0.0;
+		}
+		const size_t index = min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+		return sorted[index];
+	}
+
+}
+
+LoadReport RunLoad(const LoadOptions& options, const std::vector<std::string>& queries)
+{
+	if (queries.empty() || options.connections == 0 || options.pipeline_depth == 0) {
+		throw invalid_argument("Invalid load options"s);
+	}
+	vector<string> frames;
+	frames.reserve(queries.size());
+	for (const string& query : queries) {
+		frames.push_back(MakeFrame(query));
+	}
+
+	vector<ConnectionResult> results(options.connections);
+	vector<exception_ptr> errors(options.connections);
+	vector<thread> threads;
+	const auto start = Clock::now();
+	for (size_t i = 0; i < options.connections; ++i) {
+		threads.emplace_back([&, i] {
+			try {
+				results[i] = RunConnection(options, frames, i * options.requests_per_connection);
+			}
+			catch (...) {
+				errors[i] = current_exception();
+			}
+		});
+	}
+	for (thread& t : threads) {
+		t.join();
+	}
+	const chrono::duration<double> elapsed = Clock::now() - start;
+	for (const exception_ptr& error : errors) {
+		if (error) {
+			rethrow_exception(error);
+		}
+	}
+
+	LoadReport report;
+	vector<double> latencies;
+	for (ConnectionResult& result : results) {
+		latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+		report.errors += result.errors;
+	}
+	sort(latencies.begin(), latencies.end());
+
+	report.requests = latencies.size();
+	report.seconds = elapsed.count();
+	report.requests_per_second = report.requests / report.seconds;
+	report.latency_p50 = Percentile(latencies, 0.5);
+	report.latency_p90 = Percentile(latencies, 0.9);
+	report.latency_p99 = Percentile(latencies, 0.99);
+	report.latency_p999 = Percentile(latencies, 0.999);
+	report.latency_max = latencies.empty() ? 0.0 : latencies.back();
+	return report;
+}
+
+std::ostream& operator<<(std::ostream& out, const LoadReport& report)
+{
+	out << "requests = "s << report.requests
+		<< ", errors = "s << report.errors
+		<< ", seconds = "s << report.seconds
+		<< ", rps = "s << report.requests_per_second << '\n'
+		<< "latency us: p50 = "s << report.latency_p50
+		<< ", p90 = "s << report.latency_p90
+		<< ", p99 = "s << report.latency_p99
+		<< ", p99.9 = "s << report.latency_p999
+		<< ", max = "s << report.latency_max;
+	return out;
+}
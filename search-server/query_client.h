@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+// Генератор нагрузки для QueryServer: замкнутый цикл с заданной глубиной конвейера
+// на каждом соединении, измеряет пропускную способность и хвосты задержек.
+struct LoadOptions {
+	std::string unix_path;
+	std::string host = "127.0.0.1";
+	uint16_t port = 0;
+	size_t connections = 4;
+	size_t requests_per_connection = 10000;
+	size_t pipeline_depth = 8;
+};
+
+struct LoadReport {
+	size_t requests = 0;
+	size_t errors = 0;
+	double seconds = 0.0;
+	double requests_per_second = 0.0;
+	// Задержки в микросекундах
+	double latency_p50 = 0.0;
+	double latency_p90 = 0.0;
+	double latency_p99 = 0.0;
+	double latency_p999 = 0.0;
+	double latency_max = 0.0;
+};
+
+LoadReport RunLoad(const LoadOptions& options, const std::vector<std::string>& queries);
+
+std::ostream& operator<<(std::ostream& out, const LoadReport& report);
@@ -0,0 +1,424 @@
+#include "query_server.h"
+
+#include <algorithm>
+#include <execution>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+namespace {
+
+	const int MAX_EPOLL_EVENTS = 256;
+	const size_t MAX_IOVEC_COUNT = 1024;
+
+	[[noreturn]] void ThrowSystemError(const string& what) {
+		throw system_error(errno, generic_category(), what);
+	}
+
+	void SetNonBlocking(int fd) {
+		const int flags = fcntl(fd, F_GETFL, 0);
+		if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+			ThrowSystemError("fcntl"s);
+		}
+	}
+
+}
+
+QueryServer::QueryServer(const SearchServer& search_server, size_t max_batch_size)
+	: search_server_(search_server)
+	, max_batch_size_(max_batch_size)
+	, epoll_fd_(epoll_create1(EPOLL_CLOEXEC))
+	, wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+	if (epoll_fd_ < 0 || wake_fd_ < 0) {
+		ThrowSystemError("QueryServer"s);
+	}
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = wake_fd_;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) < 0) {
+		ThrowSystemError("epoll_ctl"s);
+	}
+}
+
+QueryServer::~QueryServer()
+{
+	for (auto& [fd, _] : connections_) {
+		close(fd);
+	}
+	for (int fd : listen_fds_) {
+		close(fd);
+	}
+	if (!unix_path_.empty()) {
+		unlink(unix_path_.c_str());
+	}
+	close(wake_fd_);
+	close(epoll_fd_);
+}
+
+void QueryServer::ListenTcp(uint16_t port)
+{
+	const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		ThrowSystemError("socket"s);
+	}
+	const int enable = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		close(fd);
+		ThrowSystemError("listen tcp"s);
+	}
+	AddListener(fd);
+}
+
+void QueryServer::ListenUnix(const std::string& path)
+{
+	sockaddr_un address{};
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw invalid_argument("Unix socket path is too long"s);
+	}
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		ThrowSystemError("socket"s);
+	}
+	address.sun_family = AF_UNIX;
+	copy(path.begin(), path.end(), address.sun_path);
+	unlink(path.c_str());
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		close(fd);
+		ThrowSystemError("listen unix"s);
+	}
+	unix_path_ = path;
+	AddListener(fd);
+}
+
+void QueryServer::Run()
+{
+	epoll_event events[MAX_EPOLL_EVENTS];
+	bool running = true;
+	while (running) {
+		const int count = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ThrowSystemError("epoll_wait"s);
+		}
+
+		// Все запросы, пришедшие за одну итерацию, обрабатываются одним пакетом
+		for (int i = 0; i < count; ++i) {
+			const int fd = events[i].data.fd;
+			if (fd == wake_fd_) {
+				uint64_t value;
+				[[maybe_unused]] auto _ = read(wake_fd_, &value, sizeof(value));
+				running = false;
+				continue;
+			}
+			if (find(listen_fds_.begin(), listen_fds_.end(), fd) != listen_fds_.end()) {
+				AcceptConnections(fd);
+				continue;
+			}
+			auto it = connections_.find(fd);
+			if (it == connections_.end()) {
+				continue;
+			}
+			Connection& connection = it->second;
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				connection.closing = true;
+			}
+			if (events[i].events & EPOLLIN) {
+				ReadAvailable(connection);
+			}
+			if (events[i].events & EPOLLOUT) {
+				FlushOutput(connection);
+			}
+			if (batch_.size() >= max_batch_size_) {
+				ProcessBatch();
+			}
+		}
+
+		if (!batch_.empty()) {
+			ProcessBatch();
+		}
+		CloseMarkedConnections();
+	}
+}
+
+void QueryServer::Stop()
+{
+	const uint64_t value = 1;
+	[[maybe_unused]] auto _ = write(wake_fd_, &value, sizeof(value));
+}
+
+void QueryServer::AddListener(int fd)
+{
+	SetNonBlocking(fd);
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+		close(fd);
+		ThrowSystemError("epoll_ctl"s);
+	}
+	listen_fds_.push_back(fd);
+}
+
+void QueryServer::AcceptConnections(int listen_fd)
+{
+	while (true) {
+		const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		const int enable = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+		epoll_event event{};
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.fd = fd;
+		if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+			close(fd);
+			continue;
+		}
+		connections_.try_emplace(fd, fd);
+	}
+}
+
+QueryServer::Connection::Connection(int fd)
+	: fd(fd)
+	, events(EPOLLIN | EPOLLRDHUP)
+{
+}
+
+// Запросы извлекаются после каждого чтения, поэтому во входном буфере остаётся
+// не больше одного незавершённого кадра. Когда пакет заполнен, чтение
+// откладывается до следующей итерации: данные ждут в сокете, а не в памяти сервера.
+// Так же чтение останавливается, пока клиент не заберёт накопившиеся ответы
+void QueryServer::ReadAvailable(Connection& connection)
+{
+	char buffer[64 * 1024];
+	while (!connection.closing && batch_.size() < max_batch_size_ && connection.output.size() < MAX_PENDING_OUTPUT) {
+		const ssize_t received = read(connection.fd, buffer, sizeof(buffer));
+		if (received > 0) {
+			connection.input.append(buffer, received);
+			ExtractQueries(connection);
+			continue;
+		}
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received == 0) {
+			connection.read_closed = true;
+			UpdateEvents(connection);
+		}
+		else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			connection.closing = true;
+		}
+		break;
+	}
+}
+
+void QueryServer::ExtractQueries(Connection& connection)
+{
+	size_t offset = 0;
+	while (connection.input.size() - offset >= sizeof(uint32_t)) {
+		uint32_t length;
+		memcpy(&length, connection.input.data() + offset, sizeof(length));
+		if (length > MAX_QUERY_FRAME_SIZE) {
+			connection.closing = true;
+			break;
+		}
+		if (connection.input.size() - offset - sizeof(length) < length) {
+			break;
+		}
+		offset += sizeof(length);
+		batch_.push_back({ connection.fd, connection.input.substr(offset, length) });
+		offset += length;
+	}
+	connection.input.erase(0, offset);
+}
+
+void QueryServer::ProcessBatch()
+{
+	vector<Response> responses(batch_.size());
+	transform(execution::par,
+		batch_.begin(), batch_.end(),
+		responses.begin(),
+		[this](const PendingQuery& query) {
+			Response response{ QUERY_ERROR_RESPONSE, {} };
+			try {
+				const vector<Document> documents = search_server_.FindTopDocuments(query.text);
+				response.count = static_cast<int32_t>(documents.size());
+				response.documents.reserve(documents.size());
+				for (const Document& document : documents) {
+					response.documents.push_back({ document.id, document.rating, document.relevance });
+				}
+			}
+			// Исключение не должно покинуть параллельный алгоритм — это std::terminate
+			catch (const exception&) {
+				response = { QUERY_ERROR_RESPONSE, {} };
+			}
+			return response;
+		});
+
+	// Ответы одного соединения уходят одной векторной записью в порядке поступления запросов
+	unordered_map<int, vector<const Response*>> by_connection;
+	vector<int> order;
+	for (size_t i = 0; i < batch_.size(); ++i) {
+		auto& connection_responses = by_connection[batch_[i].fd];
+		if (connection_responses.empty()) {
+			order.push_back(batch_[i].fd);
+		}
+		connection_responses.push_back(&responses[i]);
+	}
+	for (int fd : order) {
+		auto it = connections_.find(fd);
+		if (it != connections_.end()) {
+			WriteResponses(it->second, by_connection[fd]);
+		}
+	}
+	batch_.clear();
+}
+
+void QueryServer::WriteResponses(Connection& connection, const std::vector<const Response*>& responses)
+{
+	if (!connection.output.empty()) {
+		// Предыдущие ответы ещё не отправлены — сохраняем порядок
+		for (const Response* response : responses) {
+			connection.output.append(reinterpret_cast<const char*>(&response->count), sizeof(response->count));
+			connection.output.append(reinterpret_cast<const char*>(response->documents.data()),
+				response->documents.size() * sizeof(WireDocument));
+		}
+		UpdateEvents(connection);
+		return;
+	}
+
+	vector<iovec> iov;
+	iov.reserve(responses.size() * 2);
+	for (const Response* response : responses) {
+		iov.push_back({ const_cast<int32_t*>(&response->count), sizeof(response->count) });
+		if (!response->documents.empty()) {
+			iov.push_back({ const_cast<WireDocument*>(response->documents.data()),
+				response->documents.size() * sizeof(WireDocument) });
+		}
+	}
+
+	size_t first = 0;
+	while (first < iov.size()) {
+		const size_t count = min(iov.size() - first, MAX_IOVEC_COUNT);
+		msghdr message{};
+		message.msg_iov = iov.data() + first;
+		message.msg_iovlen = count;
+		const ssize_t written = sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				connection.closing = true;
+				return;
+			}
+			break;
+		}
+		size_t left = static_cast<size_t>(written);
+		while (first < iov.size() && left >= iov[first].iov_len) {
+			left -= iov[first].iov_len;
+			++first;
+		}
+		if (left > 0) {
+			iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+			iov[first].iov_len -= left;
+		}
+	}
+
+	if (first < iov.size()) {
+		for (; first < iov.size(); ++first) {
+			connection.output.append(static_cast<const char*>(iov[first].iov_base), iov[first].iov_len);
+		}
+		UpdateEvents(connection);
+	}
+}
+
+void QueryServer::FlushOutput(Connection& connection)
+{
+	size_t offset = 0;
+	while (offset < connection.output.size()) {
+		const ssize_t written = send(connection.fd, connection.output.data() + offset,
+			connection.output.size() - offset, MSG_NOSIGNAL);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				connection.closing = true;
+			}
+			break;
+		}
+		offset += written;
+	}
+	connection.output.erase(0, offset);
+	UpdateEvents(connection);
+}
+
+void QueryServer::UpdateEvents(Connection& connection)
+{
+	uint32_t events = 0;
+	if (!connection.read_closed && connection.output.size() < MAX_PENDING_OUTPUT) {
+		events |= EPOLLIN | EPOLLRDHUP;
+	}
+	if (!connection.output.empty()) {
+		events |= EPOLLOUT;
+	}
+	if (events == connection.events) {
+		return;
+	}
+	epoll_event event{};
+	event.events = events;
+	event.data.fd = connection.fd;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event) < 0) {
+		connection.closing = true;
+		return;
+	}
+	connection.events = events;
+}
+
+void QueryServer::CloseConnection(int fd)
+{
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+	connections_.erase(fd);
+}
+
+void QueryServer::CloseMarkedConnections()
+{
+	vector<int> closing;
+	for (const auto& [fd, connection] : connections_) {
+		// Полузакрытое соединение ждёт отправки ответов; запросы из пакета к этому моменту уже обработаны
+		if (connection.closing || (connection.read_closed && connection.output.empty())) {
+			closing.push_back(fd);
+		}
+	}
+	for (int fd : closing) {
+		CloseConnection(fd);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "document.h"
+#include "search_server.h"
+
+// Сетевой протокол (порядок байт хоста, рассчитан на локальный обмен):
+// запрос  — [uint32 длина][текст запроса];
+// ответ   — [int32 число документов][WireDocument x число],
+//           число документов == QUERY_ERROR_RESPONSE для некорректного запроса.
+// Запрос длиннее MAX_QUERY_FRAME_SIZE закрывает соединение. Пока клиенту
+// не отправлено больше MAX_PENDING_OUTPUT байт ответов, его запросы не читаются.
+struct WireDocument {
+	int32_t id;
+	int32_t rating;
+	double relevance;
+};
+
+const int32_t QUERY_ERROR_RESPONSE = -1;
+const uint32_t MAX_QUERY_FRAME_SIZE = 1 << 20;
+const size_t MAX_PENDING_OUTPUT = 4 << 20;
+
+class QueryServer {
+public:
+	explicit QueryServer(const SearchServer& search_server, size_t max_batch_size = 4096);
+	~QueryServer();
+
+	QueryServer(const QueryServer&) = delete;
+	QueryServer& operator=(const QueryServer&) = delete;
+
+	void ListenTcp(uint16_t port);
+	void ListenUnix(const std::string& path);
+
+	// Цикл обработки событий, возвращает управление после Stop()
+	void Run();
+	// Может вызываться из любого потока
+	void Stop();
+
+private:
+	struct Connection {
+		explicit Connection(int fd);
+
+		int fd;
+		std::string input;
+		std::string output;
+		// Подписка соединения в epoll
+		uint32_t events;
+		// Клиент закрыл свою сторону: соединение закрывается, когда уйдут все ответы
+		bool read_closed = false;
+		// Ошибка или нарушение протокола: соединение закрывается сразу
+		bool closing = false;
+	};
+
+	struct PendingQuery {
+		int fd;
+		std::string text;
+	};
+
+	struct Response {
+		int32_t count;
+		std::vector<WireDocument> documents;
+	};
+
+	const SearchServer& search_server_;
+	const size_t max_batch_size_;
+	int epoll_fd_;
+	int wake_fd_;
+	std::vector<int> listen_fds_;
+	std::string unix_path_;
+	std::unordered_map<int, Connection> connections_;
+	std::vector<PendingQuery> batch_;
+
+	void AddListener(int fd);
+	void AcceptConnections(int listen_fd);
+	void ReadAvailable(Connection& connection);
+	void ExtractQueries(Connection& connection);
+	void ProcessBatch();
+	void WriteResponses(Connection& connection, const std::vector<const Response*>& responses);
+	void FlushOutput(Connection& connection);
+	// Подписка на чтение, пока клиент не закрыл свою сторону и не накопил
+	// MAX_PENDING_OUTPUT неотправленных ответов, и на запись, пока они есть
+	void UpdateEvents(Connection& connection);
+	void CloseConnection(int fd);
+	void CloseMarkedConnections();
+};
@@ -0,0 +1,214 @@
+#include "query_trace.h"
+
+using namespace std;
+
+namespace {
+
+	thread_local QueryStats* current_query_stats = nullptr;
+
+	const char* const COUNTER_NAMES[] = {
+		"queries",
+		"postings_scanned",
+		"documents_scored",
+		"excluded_by_minus_words",
+		"excluded_by_predicate",
+		"documents_found",
+	};
+
+}
+
+std::string_view GetQueryPhaseName(QueryPhase phase)
+{
+	switch (phase) {
+	case QueryPhase::PARSE:
+		return "parse"sv;
+	case QueryPhase::SCORE:
+		return "score"sv;
+	case QueryPhase::MINUS_WORDS:
+		return "minus_words"sv;
+	case QueryPhase::FILTER:
+		return "filter"sv;
+	case QueryPhase::SORT:
+		return "sort"sv;
+	}
+	return "unknown"sv;
+}
+
+QueryStats& QueryStats::operator+=(const QueryStats& other)
+{
+	queries += other.queries;
+	postings_scanned += other.postings_scanned;
+	documents_scored += other.documents_scored;
+	excluded_by_minus_words += other.excluded_by_minus_words;
+	excluded_by_predicate += other.excluded_by_predicate;
+	documents_found += other.documents_found;
+	for (size_t i = 0; i < QUERY_PHASE_COUNT; ++i) {
+		phase_nanoseconds[i] += other.phase_nanoseconds[i];
+	}
+	return *this;
+}
+
+void WriteQueryStats(std::ostream& out, const QueryStats& stats, StatsFormat format)
+{
+	const uint64_t counters[] = {
+		stats.queries,
+		stats.postings_scanned,
+		stats.documents_scored,
+		stats.excluded_by_minus_words,
+		stats.excluded_by_predicate,
+		stats.documents_found,
+	};
+
+	if (format == StatsFormat::JSON) {
+		out << '{';
+		for (size_t i = 0; i < size(counters); ++i) {
+			out << '"' << COUNTER_NAMES[i] << "\":"s << counters[i] << ',';
+		}
+		out << "\"phase_ns\":{"s;
+		for (size_t i = 0; i < QUERY_PHASE_COUNT; ++i) {
+			out << (i > 0 ? ","s : ""s) << '"' << GetQueryPhaseName(static_cast<QueryPhase>(i)) << "\":"s << stats.phase_nanoseconds[i];
+		}
+		out << "}}"s;
+		return;
+	}
+
+	for (size_t i = 0; i < size(counters); ++i) {
+		out << COUNTER_NAMES[i] << " = "s << counters[i] << '\n';
+	}
+	for (size_t i = 0; i < QUERY_PHASE_COUNT; ++i) {
+		out << GetQueryPhaseName(static_cast<QueryPhase>(i)) << "_ns = "s << stats.phase_nanoseconds[i] << '\n';
+	}
+}
+
+QueryCounters::QueryCounters(const QueryCounters& other)
+{
+	Add(other.Snapshot());
+}
+
+QueryCounters& QueryCounters::operator=(const QueryCounters& other)
+{
+	if (this != &other) {
+		const QueryStats snapshot = other.Snapshot();
+		Reset();
+		Add(snapshot);
+	}
+	return *this;
+}
+
+void QueryCounters::Add(const QueryStats& stats)
+{
+	queries_.fetch_add(stats.queries, memory_order_relaxed);
+	postings_scanned_.fetch_add(stats.postings_scanned, memory_order_relaxed);
+	documents_scored_.fetch_add(stats.documents_scored, memory_order_relaxed);
+	excluded_by_minus_words_.fetch_add(stats.excluded_by_minus_words, memory_order_relaxed);
+	excluded_by_predicate_.fetch_add(stats.excluded_by_predicate, memory_order_relaxed);
+	documents_found_.fetch_add(stats.documents_found, memory_order_relaxed);
+	for (size_t i = 0; i < QUERY_PHASE_COUNT; ++i) {
+		phase_nanoseconds_[i].fetch_add(stats.phase_nanoseconds[i], memory_order_relaxed);
+	}
+}
+
+QueryStats QueryCounters::Snapshot() const
+{
+	QueryStats stats;
+	stats.queries = queries_.load(memory_order_relaxed);
+	stats.postings_scanned = postings_scanned_.load(memory_order_relaxed);
+	stats.documents_scored = documents_scored_.load(memory_order_relaxed);
+	stats.excluded_by_minus_words = excluded_by_minus_words_.load(memory_order_relaxed);
+	stats.excluded_by_predicate = excluded_by_predicate_.load(memory_order_relaxed);
+	stats.documents_found = documents_found_.load(memory_order_relaxed);
+	for (size_t i = 0; i < QUERY_PHASE_COUNT; ++i) {
+		stats.phase_nanoseconds[i] = phase_nanoseconds_[i].load(memory_order_relaxed);
+	}
+	return stats;
+}
+
+void QueryCounters::Reset()
+{
+	queries_.store(0, memory_order_relaxed);
+	postings_scanned_.store(0, memory_order_relaxed);
+	documents_scored_.store(0, memory_order_relaxed);
+	excluded_by_minus_words_.store(0, memory_order_relaxed);
+	excluded_by_predicate_.store(0, memory_order_relaxed);
+	documents_found_.store(0, memory_order_relaxed);
+	for (auto& phase : phase_nanoseconds_) {
+		phase.store(0, memory_order_relaxed);
+	}
+}
+
+QueryStatsScope::QueryStatsScope(QueryStats& stats)
+	: previous_(current_query_stats)
+{
+	current_query_stats = &stats;
+}
+
+QueryStatsScope::~QueryStatsScope()
+{
+	current_query_stats = previous_;
+}
+
+QueryStats* QueryStatsScope::Current()
+{
+	return current_query_stats;
+}
+
+#ifdef SEARCH_SERVER_TRACING
+
+QueryTracer::QueryTracer()
+	: counters_(nullptr)
+	, phase_start_(Clock::now())
+{
+}
+
+QueryTracer::QueryTracer(QueryCounters& counters)
+	: counters_(&counters)
+	, phase_start_(Clock::now())
+{
+	stats_.queries = 1;
+}
+
+QueryTracer::~QueryTracer()
+{
+	if (counters_ == nullptr) {
+		return;
+	}
+	counters_->Add(stats_);
+	if (QueryStats* scope = QueryStatsScope::Current()) {
+		*scope += stats_;
+	}
+}
+
+void QueryTracer::EndPhase(QueryPhase phase)
+{
+	const Clock::time_point now = Clock::now();
+	stats_.phase_nanoseconds[static_cast<size_t>(phase)] +=
+		std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start_).count();
+	phase_start_ = now;
+}
+
+void QueryTracer::AddPostingsScanned(size_t count)
+{
+	stats_.postings_scanned += count;
+}
+
+void QueryTracer::AddDocumentsScored(size_t count)
+{
+	stats_.documents_scored += count;
+}
+
+void QueryTracer::AddExcludedByMinusWords(size_t count)
+{
+	stats_.excluded_by_minus_words += count;
+}
+
+void QueryTracer::AddExcludedByPredicate(size_t count)
+{
+	stats_.excluded_by_predicate += count;
+}
+
+void QueryTracer::SetDocumentsFound(size_t count)
+{
+	stats_.documents_found = count;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Трассировка поисковых запросов. Включается при сборке с SEARCH_SERVER_TRACING,
+// без него QueryTracer пуст и все вызовы трассировки вырезаются компилятором.
+
+enum class QueryPhase {
+	PARSE,
+	SCORE,
+	MINUS_WORDS,
+	FILTER,
+	SORT,
+};
+
+const size_t QUERY_PHASE_COUNT = 5;
+
+std::string_view GetQueryPhaseName(QueryPhase phase);
+
+struct QueryStats {
+	uint64_t queries = 0;
+	uint64_t postings_scanned = 0;
+	uint64_t documents_scored = 0;
+	uint64_t excluded_by_minus_words = 0;
+	uint64_t excluded_by_predicate = 0;
+	uint64_t documents_found = 0;
+	std::array<uint64_t, QUERY_PHASE_COUNT> phase_nanoseconds{};
+
+	QueryStats& operator+=(const QueryStats& other);
+};
+
+enum class StatsFormat {
+	TEXT,
+	JSON,
+};
+
+void WriteQueryStats(std::ostream& out, const QueryStats& stats, StatsFormat format = StatsFormat::TEXT);
+
+// Накопительные счётчики сервера, обновляются из любого числа потоков
+class QueryCounters {
+public:
+	QueryCounters() = default;
+	QueryCounters(const QueryCounters& other);
+	QueryCounters& operator=(const QueryCounters& other);
+
+	void Add(const QueryStats& stats);
+	QueryStats Snapshot() const;
+	void Reset();
+
+private:
+	std::atomic<uint64_t> queries_{ 0 };
+	std::atomic<uint64_t> postings_scanned_{ 0 };
+	std::atomic<uint64_t> documents_scored_{ 0 };
+	std::atomic<uint64_t> excluded_by_minus_words_{ 0 };
+	std::atomic<uint64_t> excluded_by_predicate_{ 0 };
+	std::atomic<uint64_t> documents_found_{ 0 };
+	std::array<std::atomic<uint64_t>, QUERY_PHASE_COUNT> phase_nanoseconds_{};
+};
+
+// Собирает статистику запросов, выполненных в этом потоке, пока объект жив
+class QueryStatsScope {
+public:
+	explicit QueryStatsScope(QueryStats& stats);
+	~QueryStatsScope();
+
+	QueryStatsScope(const QueryStatsScope&) = delete;
+	QueryStatsScope& operator=(const QueryStatsScope&) = delete;
+
+	static QueryStats* Current();
+
+private:
+	QueryStats* previous_;
+};
+
+#ifdef SEARCH_SERVER_TRACING
+
+class QueryTracer {
+public:
+	static constexpr bool ENABLED = true;
+
+	// Без счётчиков статистика никуда не публикуется
+	QueryTracer();
+	explicit QueryTracer(QueryCounters& counters);
+	~QueryTracer();
+
+	QueryTracer(const QueryTracer&) = delete;
+	QueryTracer& operator=(const QueryTracer&) = delete;
+
+	// Относит время с предыдущей отметки к завершившейся фазе
+	void EndPhase(QueryPhase phase);
+
+	void AddPostingsScanned(size_t count);
+	void AddDocumentsScored(size_t count);
+	void AddExcludedByMinusWords(size_t count);
+	void AddExcludedByPredicate(size_t count);
+	void SetDocumentsFound(size_t count);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	QueryCounters* counters_;
+	QueryStats stats_;
+	Clock::time_point phase_start_;
+};
+
+#else
+
+class QueryTracer {
+public:
+	static constexpr bool ENABLED = false;
+
+	QueryTracer() = default;
+	explicit QueryTracer(QueryCounters&) {}
+
+	void EndPhase(QueryPhase) {}
+	void AddPostingsScanned(size_t) {}
+	void AddDocumentsScored(size_t) {}
+	void AddExcludedByMinusWords(size_t) {}
+	void AddExcludedByPredicate(size_t) {}
+	void SetDocumentsFound(size_t) {}
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include "result_writer.h"
+
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+	// Запись документа в любом формате короче: числа занимают не больше 24 символов
+	const size_t MAX_DOCUMENT_SIZE = 128;
+
+	char* AppendLiteral(char* out, string_view text) {
+		memcpy(out, text.data(), text.size());
+		return out + text.size();
+	}
+
+	char* AppendInt(char* out, int value) {
+		return to_chars(out, out + 11, value).ptr;
+	}
+
+	// Как operator<< для double с настройками потока по умолчанию
+	char* AppendTextDouble(char* out, double value) {
+		return to_chars(out, out + 24, value, chars_format::general, 6).ptr;
+	}
+
+	// Кратчайшая запись, которая читается обратно в то же значение
+	char* AppendJsonDouble(char* out, double value) {
+		if (!isfinite(value)) {
+			return AppendLiteral(out, "null"sv);
+		}
+		return to_chars(out, out + 24, value).ptr;
+	}
+
+	template <typename T>
+	char* AppendBinary(char* out, T value) {
+		memcpy(out, &value, sizeof(value));
+		return out + sizeof(value);
+	}
+
+}
+
+ResultWriter::ResultWriter(int fd, ResultFormat format, size_t buffer_size)
+	: fd_(fd)
+	, format_(format)
+{
+	if (buffer_size < MAX_DOCUMENT_SIZE) {
+		throw invalid_argument("Result buffer is too small"s);
+	}
+	buffer_.resize(buffer_size);
+}
+
+ResultWriter::~ResultWriter()
+{
+	try {
+		Flush();
+	}
+	catch (...) {
+	}
+}
+
+void ResultWriter::Write(const Document& document)
+{
+	AppendDocument(document);
+	if (format_ == ResultFormat::JSON_LINES) {
+		Append("\n", 1);
+	}
+}
+
+void ResultWriter::Write(const std::vector<Document>& documents)
+{
+	if (format_ == ResultFormat::BINARY) {
+		const int32_t count = static_cast<int32_t>(documents.size());
+		Append(&count, sizeof(count));
+		for (const Document& document : documents) {
+			AppendDocument(document);
+		}
+		return;
+	}
+	if (format_ == ResultFormat::JSON_LINES) {
+		Append("[", 1);
+		for (size_t i = 0; i < documents.size(); ++i) {
+			if (i > 0) {
+				Append(",", 1);
+			}
+			AppendDocument(documents[i]);
+		}
+		Append("]\n", 2);
+		return;
+	}
+	for (const Document& document : documents) {
+		AppendDocument(document);
+	}
+}
+
+void ResultWriter::WriteMatch(int document_id, const std::vector<std::string_view>& words, DocumentStatus status)
+{
+	const int status_code = static_cast<int>(status);
+	if (format_ == ResultFormat::BINARY) {
+		char* out = Reserve(3 * sizeof(int32_t));
+		out = AppendBinary<int32_t>(out, document_id);
+		out = AppendBinary<int32_t>(out, status_code);
+		out = AppendBinary<uint32_t>(out, static_cast<uint32_t>(words.size()));
+		size_ = out - buffer_.data();
+		for (const string_view word : words) {
+			const uint32_t length = static_cast<uint32_t>(word.size());
+			Append(&length, sizeof(length));
+			Append(word.data(), word.size());
+		}
+		return;
+	}
+
+	char* out = Reserve(MAX_DOCUMENT_SIZE);
+	if (format_ == ResultFormat::JSON_LINES) {
+		out = AppendLiteral(out, "{\"document_id\":"sv);
+		out = AppendInt(out, document_id);
+		out = AppendLiteral(out, ",\"status\":"sv);
+		out = AppendInt(out, status_code);
+		out = AppendLiteral(out, ",\"words\":["sv);
+		size_ = out - buffer_.data();
+		for (size_t i = 0; i < words.size(); ++i) {
+			if (i > 0) {
+				Append(",", 1);
+			}
+			AppendJsonString(words[i]);
+		}
+		Append("]}\n", 3);
+		return;
+	}
+	out = AppendLiteral(out, "{ document_id = "sv);
+	out = AppendInt(out, document_id);
+	out = AppendLiteral(out, ", status = "sv);
+	out = AppendInt(out, status_code);
+	out = AppendLiteral(out, ", words ="sv);
+	size_ = out - buffer_.data();
+	for (const string_view word : words) {
+		Append(" ", 1);
+		Append(word.data(), word.size());
+	}
+	Append("}\n", 2);
+}
+
+void ResultWriter::Flush()
+{
+	const size_t size = size_;
+	size_ = 0;
+	WriteAll(buffer_.data(), size);
+}
+
+ResultFormat ResultWriter::GetFormat() const
+{
+	return format_;
+}
+
+size_t ResultWriter::GetBufferedSize() const
+{
+	return size_;
+}
+
+char* ResultWriter::Reserve(size_t bytes)
+{
+	if (size_ + bytes > buffer_.size()) {
+		Flush();
+	}
+	return buffer_.data() + size_;
+}
+
+void ResultWriter::Append(const void* data, size_t bytes)
+{
+	// Длинные участки не копируются в буфер, а пишутся сразу за ним
+	if (bytes > buffer_.size() / 2) {
+		Flush();
+		WriteAll(static_cast<const char*>(data), bytes);
+		return;
+	}
+	memcpy(Reserve(bytes), data, bytes);
+	size_ += bytes;
+}
+
+void ResultWriter::AppendDocument(const Document& document)
+{
+	char* out = Reserve(MAX_DOCUMENT_SIZE);
+	switch (format_) {
+	case ResultFormat::TEXT:
+		out = AppendLiteral(out, "{ document_id = "sv);
+		out = AppendInt(out, document.id);
+		out = AppendLiteral(out, ", relevance = "sv);
+		out = AppendTextDouble(out, document.relevance);
+		out = AppendLiteral(out, ", rating = "sv);
+		out = AppendInt(out, document.rating);
+		out = AppendLiteral(out, " }\n"sv);
+		break;
+	case ResultFormat::JSON_LINES:
+		out = AppendLiteral(out, "{\"document_id\":"sv);
+		out = AppendInt(out, document.id);
+		out = AppendLiteral(out, ",\"relevance\":"sv);
+		out = AppendJsonDouble(out, document.relevance);
+		out = AppendLiteral(out, ",\"rating\":"sv);
+		out = AppendInt(out, document.rating);
+		out = AppendLiteral(out, "}"sv);
+		break;
+	case ResultFormat::BINARY:
+		out = AppendBinary<int32_t>(out, document.id);
+		out = AppendBinary<int32_t>(out, document.rating);
+		out = AppendBinary<double>(out, document.relevance);
+		break;
+	}
+	size_ = out - buffer_.data();
+}
+
+void ResultWriter::AppendJsonString(std::string_view text)
+{
+	static const char HEX_DIGITS[] = "0123456789abcdef";
+	Append("\"", 1);
+	size_t first = 0;
+	for (size_t i = 0; i < text.size(); ++i) {
+		const auto c = static_cast<unsigned char>(text[i]);
+		if (c != '"' && c != '\\' && c >= 0x20) {
+			continue;
+		}
+		Append(text.data() + first, i - first);
+		if (c == '"' || c == '\\') {
+			const char escaped[] = { '\\', static_cast<char>(c) };
+			Append(escaped, sizeof(escaped));
+		}
+		else {
+			const char escaped[] = { '\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF] };
+			Append(escaped, sizeof(escaped));
+		}
+		first = i + 1;
+	}
+	Append(text.data() + first, text.size() - first);
+	Append("\"", 1);
+}
+
+void ResultWriter::WriteAll(const char* data, size_t bytes)
+{
+	while (bytes > 0) {
+		const ssize_t written = write(fd_, data, bytes);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw system_error(errno, generic_category(), "Result write failed"s);
+		}
+		data += written;
+		bytes -= static_cast<size_t>(written);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "document.h"
+
+enum class ResultFormat {
+	// Как PrintDocument и PrintMatchDocumentResult
+	TEXT,
+	// Объект JSON на строку: документ, результат запроса (массив) или совпадение
+	JSON_LINES,
+	// Порядок байт хоста. Документ — [int32 id][int32 rating][double relevance],
+	// результат запроса — [int32 число документов][документы], как ответ QueryServer,
+	// совпадение — [int32 id][int32 статус][uint32 число слов]([uint32 длина][байты])*
+	BINARY,
+};
+
+// Буферизованная запись результатов поиска в файловый дескриптор.
+// Записи форматируются через std::to_chars в переиспользуемый буфер,
+// который сбрасывается в дескриптор крупными write при заполнении.
+// Ошибка записи выбрасывается как std::system_error, несброшенные данные теряются
+class ResultWriter {
+public:
+	static const size_t DEFAULT_BUFFER_SIZE = 256 * 1024;
+
+	explicit ResultWriter(int fd, ResultFormat format = ResultFormat::TEXT, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+	// Сбрасывает буфер; ошибка записи здесь теряется, поэтому стоит вызвать Flush
+	~ResultWriter();
+
+	ResultWriter(const ResultWriter&) = delete;
+	ResultWriter& operator=(const ResultWriter&) = delete;
+
+	void Write(const Document& document);
+	// Результат одного запроса
+	void Write(const std::vector<Document>& documents);
+	void WriteMatch(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
+
+	void Flush();
+
+	ResultFormat GetFormat() const;
+	size_t GetBufferedSize() const;
+
+private:
+	int fd_;
+	ResultFormat format_;
+	std::vector<char> buffer_;
+	size_t size_ = 0;
+
+	// Место под bytes байт, не больше размера буфера; при нехватке буфер сбрасывается
+	char* Reserve(size_t bytes);
+	void Append(const void* data, size_t bytes);
+	void AppendDocument(const Document& document);
+	void AppendJsonString(std::string_view text);
+	void WriteAll(const char* data, size_t bytes);
+};
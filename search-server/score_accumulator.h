@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "prefetch.h"
+
+// Плотный накопитель релевантности по слотам документов.
+// Сбрасываются только задетые слоты, поэтому один экземпляр на поток
+// переиспользуется между запросами без обнуления всего массива.
+template <typename Score>
+class ScoreAccumulator {
+public:
+	static ScoreAccumulator& ForThread() {
+		thread_local ScoreAccumulator accumulator;
+		return accumulator;
+	}
+
+	void Reset(size_t slot_count) {
+		for (const uint32_t slot : candidates_) {
+			scores_[slot] = 0;
+			marks_[slot] = NONE;
+		}
+		candidates_.clear();
+		if (scores_.size() < slot_count) {
+			scores_.resize(slot_count, 0);
+			marks_.resize(slot_count, NONE);
+		}
+	}
+
+	Score* Scores() {
+		return scores_.data();
+	}
+
+	Score GetScore(uint32_t slot) const {
+		return scores_[slot];
+	}
+
+	void Touch(const uint32_t* slots, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			if (marks_[slots[i]] == NONE) {
+				marks_[slots[i]] = CANDIDATE;
+				candidates_.push_back(slots[i]);
+			}
+		}
+	}
+
+	// Возвращает число впервые исключённых кандидатов
+	size_t Exclude(const uint32_t* slots, size_t count) {
+		size_t excluded = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (marks_[slots[i]] == CANDIDATE) {
+				marks_[slots[i]] = EXCLUDED;
+				++excluded;
+			}
+		}
+		return excluded;
+	}
+
+	bool IsExcluded(uint32_t slot) const {
+		return marks_[slot] == EXCLUDED;
+	}
+
+	// Предвыборка отметки и релевантности слота перед IsExcluded и GetScore
+	void Prefetch(uint32_t slot) const {
+		PrefetchForRead(marks_.data() + slot);
+		PrefetchForRead(scores_.data() + slot);
+	}
+
+	const std::vector<uint32_t>& Candidates() const {
+		return candidates_;
+	}
+
+private:
+	enum Mark : uint8_t {
+		NONE,
+		CANDIDATE,
+		EXCLUDED,
+	};
+
+	std::vector<Score> scores_;
+	std::vector<uint8_t> marks_;
+	std::vector<uint32_t> candidates_;
+};
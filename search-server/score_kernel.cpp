@@ -0,0 +1,204 @@
+#include "score_kernel.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#include "prefetch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCORE_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+	template <typename Score>
+	void AccumulateScalar(const uint32_t* slots, const double* term_freqs, size_t count, Score idf, Score* scores) {
+		for (size_t i = 0; i < count; ++i) {
+			scores[slots[i]] += static_cast<Score>(term_freqs[i]) * idf;
+		}
+	}
+
+	// Накопители следующих lanes слотов, если до конца списка их хватает.
+	// На больших индексах накопители не помещаются в кэш и TLB, и без
+	// предвыборки каждое обращение по слоту ждёт памяти
+	template <typename Score>
+	void PrefetchScores(const uint32_t* slots, size_t position, size_t count, size_t lanes, Score* scores) {
+		if (position + PREFETCH_DISTANCE + lanes <= count) {
+			for (size_t lane = 0; lane < lanes; ++lane) {
+				PrefetchForWrite(scores + slots[position + PREFETCH_DISTANCE + lane]);
+			}
+		}
+	}
+
+	template <typename Score>
+	void AccumulatePrefetched(const uint32_t* slots, const double* term_freqs, size_t count, Score idf, Score* scores) {
+		for (size_t i = 0; i < count; ++i) {
+			PrefetchScores(slots, i, count, 1, scores);
+			scores[slots[i]] += static_cast<Score>(term_freqs[i]) * idf;
+		}
+	}
+
+#ifdef SCORE_KERNEL_X86
+	// В double-ядрах умножение и сложение не сливаются в FMA,
+	// чтобы результат совпадал со скалярным побитово. Без fp-contract=off
+	// компилятор сливает _mm*_mul_pd и _mm*_add_pd сам
+
+	__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+	void AccumulateDoubleAvx2(const uint32_t* slots, const double* term_freqs, size_t count, double idf, double* scores) {
+		const __m256d idf4 = _mm256_set1_pd(idf);
+		alignas(32) double result[4];
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			PrefetchScores(slots, i, count, 4, scores);
+			const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slots + i));
+			const __m256d current = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), scores, index, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+			const __m256d contribution = _mm256_mul_pd(_mm256_loadu_pd(term_freqs + i), idf4);
+			_mm256_store_pd(result, _mm256_add_pd(current, contribution));
+			scores[slots[i]] = result[0];
+			scores[slots[i + 1]] = result[1];
+			scores[slots[i + 2]] = result[2];
+			scores[slots[i + 3]] = result[3];
+		}
+		AccumulateScalar(slots + i, term_freqs + i, count - i, idf, scores);
+	}
+
+	__attribute__((target("avx2,fma")))
+	void AccumulateFloatAvx2(const uint32_t* slots, const double* term_freqs, size_t count, float idf, float* scores) {
+		const __m256 idf8 = _mm256_set1_ps(idf);
+		alignas(32) float result[8];
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			PrefetchScores(slots, i, count, 8, scores);
+			const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i));
+			const __m128 low = _mm256_cvtpd_ps(_mm256_loadu_pd(term_freqs + i));
+			const __m128 high = _mm256_cvtpd_ps(_mm256_loadu_pd(term_freqs + i + 4));
+			const __m256 freqs = _mm256_set_m128(high, low);
+			const __m256 current = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), scores, index, _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+			_mm256_store_ps(result, _mm256_fmadd_ps(freqs, idf8, current));
+			for (size_t lane = 0; lane < 8; ++lane) {
+				scores[slots[i + lane]] = result[lane];
+			}
+		}
+		AccumulateScalar(slots + i, term_freqs + i, count - i, idf, scores);
+	}
+
+	__attribute__((target("avx512f,avx512dq"), optimize("fp-contract=off")))
+	void AccumulateDoubleAvx512(const uint32_t* slots, const double* term_freqs, size_t count, double idf, double* scores) {
+		const __m512d idf8 = _mm512_set1_pd(idf);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			PrefetchScores(slots, i, count, 8, scores);
+			const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i));
+			const __m512d current = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, index, scores, 8);
+			const __m512d contribution = _mm512_mul_pd(_mm512_loadu_pd(term_freqs + i), idf8);
+			_mm512_i32scatter_pd(scores, index, _mm512_add_pd(current, contribution), 8);
+		}
+		AccumulateScalar(slots + i, term_freqs + i, count - i, idf, scores);
+	}
+
+	__attribute__((target("avx512f,avx512dq")))
+	void AccumulateFloatAvx512(const uint32_t* slots, const double* term_freqs, size_t count, float idf, float* scores) {
+		const __m512 idf16 = _mm512_set1_ps(idf);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			PrefetchScores(slots, i, count, 16, scores);
+			const __m512i index = _mm512_loadu_si512(slots + i);
+			const __m256 low = _mm512_maskz_cvtpd_ps(0xFF, _mm512_loadu_pd(term_freqs + i));
+			const __m256 high = _mm512_maskz_cvtpd_ps(0xFF, _mm512_loadu_pd(term_freqs + i + 8));
+			const __m512 freqs = _mm512_insertf32x8(_mm512_insertf32x8(_mm512_setzero_ps(), low, 0), high, 1);
+			const __m512 current = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, index, scores, 4);
+			_mm512_i32scatter_ps(scores, index, _mm512_fmadd_ps(freqs, idf16, current), 4);
+		}
+		AccumulateScalar(slots + i, term_freqs + i, count - i, idf, scores);
+	}
+#endif
+
+	ScoreKernel DetectScoreKernel() {
+		if (IsScoreKernelSupported(ScoreKernel::AVX512)) {
+			return ScoreKernel::AVX512;
+		}
+		if (IsScoreKernelSupported(ScoreKernel::AVX2)) {
+			return ScoreKernel::AVX2;
+		}
+		return ScoreKernel::SCALAR;
+	}
+
+	atomic<ScoreKernel>& CurrentScoreKernel() {
+		static atomic<ScoreKernel> kernel(DetectScoreKernel());
+		return kernel;
+	}
+
+}
+
+void AccumulateScores(const uint32_t* slots, const double* term_freqs, size_t count, double idf, double* scores)
+{
+	switch (CurrentScoreKernel().load(memory_order_relaxed)) {
+#ifdef SCORE_KERNEL_X86
+	case ScoreKernel::AVX512:
+		return AccumulateDoubleAvx512(slots, term_freqs, count, idf, scores);
+	case ScoreKernel::AVX2:
+		return AccumulateDoubleAvx2(slots, term_freqs, count, idf, scores);
+#endif
+	default:
+		return AccumulatePrefetched(slots, term_freqs, count, idf, scores);
+	}
+}
+
+void AccumulateScores(const uint32_t* slots, const double* term_freqs, size_t count, float idf, float* scores)
+{
+	switch (CurrentScoreKernel().load(memory_order_relaxed)) {
+#ifdef SCORE_KERNEL_X86
+	case ScoreKernel::AVX512:
+		return AccumulateFloatAvx512(slots, term_freqs, count, idf, scores);
+	case ScoreKernel::AVX2:
+		return AccumulateFloatAvx2(slots, term_freqs, count, idf, scores);
+#endif
+	default:
+		return AccumulatePrefetched(slots, term_freqs, count, idf, scores);
+	}
+}
+
+ScoreKernel GetScoreKernel()
+{
+	return CurrentScoreKernel().load();
+}
+
+void SetScoreKernel(ScoreKernel kernel)
+{
+	if (!IsScoreKernelSupported(kernel)) {
+		throw invalid_argument("Score kernel "s + string{ GetScoreKernelName(kernel) } + " is not supported"s);
+	}
+	CurrentScoreKernel().store(kernel);
+}
+
+bool IsScoreKernelSupported(ScoreKernel kernel)
+{
+	switch (kernel) {
+	case ScoreKernel::SCALAR:
+		return true;
+#ifdef SCORE_KERNEL_X86
+	case ScoreKernel::AVX2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	case ScoreKernel::AVX512:
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+#endif
+	default:
+		return false;
+	}
+}
+
+std::string_view GetScoreKernelName(ScoreKernel kernel)
+{
+	switch (kernel) {
+	case ScoreKernel::AVX2:
+		return "avx2"sv;
+	case ScoreKernel::AVX512:
+		return "avx512"sv;
+	default:
+		return "scalar"sv;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Тип накопителя релевантности при поиске
+enum class ScoreType {
+	DOUBLE,
+	FLOAT,
+};
+
+enum class ScoreKernel {
+	SCALAR,
+	AVX2,
+	AVX512,
+};
+
+// scores[slots[i]] += term_freqs[i] * idf для i < count.
+// Слоты в одном вызове должны быть уникальны.
+void AccumulateScores(const uint32_t* slots, const double* term_freqs, size_t count, double idf, double* scores);
+void AccumulateScores(const uint32_t* slots, const double* term_freqs, size_t count, float idf, float* scores);
+
+// По умолчанию выбирается лучшая реализация, поддерживаемая процессором
+ScoreKernel GetScoreKernel();
+void SetScoreKernel(ScoreKernel kernel);
+bool IsScoreKernelSupported(ScoreKernel kernel);
+std::string_view GetScoreKernelName(ScoreKernel kernel);
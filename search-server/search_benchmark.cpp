@@ -0,0 +1,272 @@
+#include "search_benchmark.h"
+
+#include <algorithm>
+#include <execution>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+
+#include "execution_cost_model.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+using namespace std;
+
+namespace {
+
+	// Первые слова словаря — самые частые — служат стоп-словами
+	const size_t STOP_WORD_COUNT = 2;
+	// Удаляется каждый такой документ
+	const size_t REMOVE_STEP = 10;
+
+	struct Corpus {
+		vector<string> vocabulary;
+		vector<string> documents;
+		vector<string> queries;
+		size_t document_words = 0;
+		size_t document_unique_words = 0;
+		size_t removed_unique_words = 0;
+		size_t query_words = 0;
+		size_t query_postings = 0;
+	};
+
+	Corpus MakeCorpus(const BenchmarkOptions& options) {
+		mt19937_64 generator(options.seed);
+		Corpus corpus;
+
+		set<string> unique_words;
+		uniform_int_distribution<size_t> length(3, 10);
+		uniform_int_distribution<int> letter('a', 'z');
+		while (corpus.vocabulary.size() < options.vocabulary_size) {
+			string word(length(generator), ' ');
+			for (char& c : word) {
+				c = static_cast<char>(letter(generator));
+			}
+			if (unique_words.insert(word).second) {
+				corpus.vocabulary.push_back(move(word));
+			}
+		}
+
+		// Слово ранга r выбирается с вероятностью, пропорциональной 1 / (r + 1)
+		vector<double> cumulative(options.vocabulary_size);
+		double total = 0.0;
+		for (size_t r = 0; r < options.vocabulary_size; ++r) {
+			cumulative[r] = total += 1.0 / static_cast<double>(r + 1);
+		}
+		uniform_real_distribution<double> uniform(0.0, total);
+		const auto random_rank = [&] {
+			return min<size_t>(upper_bound(cumulative.begin(), cumulative.end(), uniform(generator)) - cumulative.begin(), options.vocabulary_size - 1);
+		};
+
+		vector<size_t> document_freqs(options.vocabulary_size, 0);
+		vector<size_t> ranks;
+		for (size_t d = 0; d < options.document_count; ++d) {
+			string text;
+			ranks.clear();
+			for (size_t w = 0; w < options.words_per_document; ++w) {
+				const size_t rank = random_rank();
+				text += (w > 0 ? " "s : ""s) + corpus.vocabulary[rank];
+				if (rank >= STOP_WORD_COUNT) {
+					ranks.push_back(rank);
+				}
+			}
+			corpus.document_words += ranks.size();
+			sort(ranks.begin(), ranks.end());
+			ranks.erase(unique(ranks.begin(), ranks.end()), ranks.end());
+			for (const size_t rank : ranks) {
+				++document_freqs[rank];
+			}
+			corpus.document_unique_words += ranks.size();
+			if (d % REMOVE_STEP == 0) {
+				corpus.removed_unique_words += ranks.size();
+			}
+			corpus.documents.push_back(move(text));
+		}
+
+		// Четверть запросов с минус-словом
+		for (size_t q = 0; q < options.query_count; ++q) {
+			string query;
+			// Повторное слово запроса разбирается один раз
+			ranks.clear();
+			for (size_t w = 0; w < options.words_per_query; ++w) {
+				const size_t rank = max(random_rank(), STOP_WORD_COUNT);
+				const bool minus = w + 1 == options.words_per_query && options.words_per_query > 1 && q % 4 == 0;
+				query += (w > 0 ? " "s : ""s) + (minus ? "-"s : ""s) + corpus.vocabulary[rank];
+				ranks.push_back(rank);
+			}
+			sort(ranks.begin(), ranks.end());
+			ranks.erase(unique(ranks.begin(), ranks.end()), ranks.end());
+			for (const size_t rank : ranks) {
+				corpus.query_postings += document_freqs[rank];
+			}
+			corpus.query_words += options.words_per_query;
+			corpus.queries.push_back(move(query));
+		}
+		return corpus;
+	}
+
+	// Сумма размеров результатов не даёт компилятору выбросить замеряемый вызов
+	volatile size_t result_sink = 0;
+
+}
+
+BenchmarkReport RunSearchBenchmarks(const BenchmarkOptions& options)
+{
+	if (options.document_count == 0 || options.vocabulary_size <= STOP_WORD_COUNT
+		|| options.words_per_document == 0 || options.query_count == 0
+		|| options.words_per_query == 0 || options.repeat_count == 0) {
+		throw invalid_argument("Invalid benchmark options"s);
+	}
+	const Corpus corpus = MakeCorpus(options);
+	const size_t document_count = options.document_count;
+	const size_t query_count = options.query_count;
+	const size_t removed_count = (document_count + REMOVE_STEP - 1) / REMOVE_STEP;
+
+	BenchmarkReport report;
+	report.allocation = options.allocation;
+	vector<BenchmarkResult>& results = report.results;
+	results = {
+		{ "split_into_words"s, document_count, corpus.document_words, {} },
+		{ "add_document"s, document_count, corpus.document_words, {} },
+		{ "parse_query"s, query_count, corpus.query_words, {} },
+		{ "find_top_documents_seq"s, query_count, corpus.query_postings, {} },
+		{ "find_top_documents_par"s, query_count, corpus.query_postings, {} },
+		{ "reorder_documents"s, document_count, corpus.document_unique_words, {} },
+		{ "find_top_documents_reordered"s, query_count, corpus.query_postings, {} },
+		{ "remove_document"s, removed_count, corpus.removed_unique_words, {} },
+	};
+	vector<vector<PerfSample>> samples(results.size());
+
+	// Калибровка модели выполнения не должна попасть в замеры
+	ExecutionCostModel::Instance();
+	string stop_words = corpus.vocabulary[0];
+	for (size_t i = 1; i < STOP_WORD_COUNT; ++i) {
+		stop_words += " "s + corpus.vocabulary[i];
+	}
+
+	PerfCounters counters;
+	for (size_t repeat = 0; repeat < options.repeat_count; ++repeat) {
+		SearchServer search_server(stop_words, options.allocation);
+		size_t b = 0;
+
+		samples[b++].push_back(counters.Measure([&] {
+			for (const string& text : corpus.documents) {
+				result_sink = result_sink + SplitIntoWords(text).size();
+			}
+			}));
+		samples[b++].push_back(counters.Measure([&] {
+			for (size_t d = 0; d < document_count; ++d) {
+				search_server.AddDocument(static_cast<int>(d), corpus.documents[d], DocumentStatus::ACTUAL, { 1, 2, 3 });
+			}
+			}));
+		report.memory = search_server.GetMemoryStats();
+		// Разбор запроса без документов — весь MatchDocuments
+		const vector<int> no_documents;
+		samples[b++].push_back(counters.Measure([&] {
+			for (const string& query : corpus.queries) {
+				result_sink = result_sink + search_server.MatchDocuments(query, no_documents).size();
+			}
+			}));
+		samples[b++].push_back(counters.Measure([&] {
+			for (const string& query : corpus.queries) {
+				result_sink = result_sink + search_server.FindTopDocuments(execution::seq, query).size();
+			}
+			}));
+		samples[b++].push_back(counters.Measure([&] {
+			for (const string& query : corpus.queries) {
+				result_sink = result_sink + search_server.FindTopDocuments(execution::par, query).size();
+			}
+			}));
+		samples[b++].push_back(counters.Measure([&] {
+			report.reorder = search_server.ReorderDocuments();
+			}));
+		samples[b++].push_back(counters.Measure([&] {
+			for (const string& query : corpus.queries) {
+				result_sink = result_sink + search_server.FindTopDocuments(execution::seq, query).size();
+			}
+			}));
+		samples[b++].push_back(counters.Measure([&] {
+			for (size_t d = 0; d < document_count; d += REMOVE_STEP) {
+				search_server.RemoveDocument(static_cast<int>(d));
+			}
+			}));
+	}
+
+	for (size_t b = 0; b < results.size(); ++b) {
+		vector<PerfSample>& repeats = samples[b];
+		nth_element(repeats.begin(), repeats.begin() + repeats.size() / 2, repeats.end(), [](const PerfSample& lhs, const PerfSample& rhs) {
+			return lhs.nanoseconds < rhs.nanoseconds;
+			});
+		results[b].sample = repeats[repeats.size() / 2];
+	}
+	return report;
+}
+
+void WriteBenchmarkReport(std::ostream& out, const BenchmarkReport& report, StatsFormat format)
+{
+	const vector<BenchmarkResult>& results = report.results;
+	const MemoryStats& memory = report.memory;
+	const string_view allocation = report.allocation == IndexAllocation::HUGE_PAGES ? "huge_pages"sv : "heap"sv;
+	if (format == StatsFormat::JSON) {
+		out << "{\"allocation\":\""s << allocation
+			<< "\",\"inverted_index\":"s << memory.inverted_index
+			<< ",\"forward_index\":"s << memory.forward_index
+			<< ",\"documents\":"s << memory.documents
+			<< ",\"index_arena\":"s << memory.index_arena
+			<< ",\"reordered_total\":"s << report.reorder.memory_after.Total()
+			<< ",\"gap_bits\":"s << report.reorder.gap_bits_before
+			<< ",\"reordered_gap_bits\":"s << report.reorder.gap_bits_after << "}\n"s;
+		for (const BenchmarkResult& result : results) {
+			out << "{\"name\":\""s << result.name
+				<< "\",\"operations\":"s << result.operations
+				<< ",\"postings\":"s << result.postings
+				<< ",\"ns\":"s << result.sample.nanoseconds;
+			for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+				out << ",\""s << GetPerfEventName(static_cast<PerfEvent>(i)) << "\":"s;
+				if (result.sample.available[i]) {
+					out << result.sample.values[i];
+				}
+				else {
+					out << "null"s;
+				}
+			}
+			out << "}\n"s;
+		}
+		return;
+	}
+
+	out << "allocation = "s << allocation
+		<< ", inverted_index = "s << memory.inverted_index
+		<< ", forward_index = "s << memory.forward_index
+		<< ", documents = "s << memory.documents
+		<< ", index_arena = "s << memory.index_arena << '\n'
+		<< "reorder: total = "s << report.reorder.memory_before.Total() << " -> "s << report.reorder.memory_after.Total()
+		<< ", gap_bits = "s << report.reorder.gap_bits_before << " -> "s << report.reorder.gap_bits_after << '\n';
+	if (!results.empty()) {
+		out << "perf counters:"s;
+		for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+			out << (i > 0 ? ","s : ""s) << ' ' << GetPerfEventName(static_cast<PerfEvent>(i))
+				<< (results.front().sample.available[i] ? ""s : " (unavailable)"s);
+		}
+		out << '\n';
+	}
+	const auto write_ratio = [&out](string_view name, double value, const BenchmarkResult& result) {
+		out << ", "s << name << "/op = "s << value / static_cast<double>(max<size_t>(result.operations, 1))
+			<< ", "s << name << "/posting = "s << value / static_cast<double>(max<size_t>(result.postings, 1));
+	};
+	for (const BenchmarkResult& result : results) {
+		const PerfSample& sample = result.sample;
+		out << result.name << ": operations = "s << result.operations << ", postings = "s << result.postings;
+		write_ratio("ns"sv, static_cast<double>(sample.nanoseconds), result);
+		for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+			if (sample.available[i]) {
+				write_ratio(GetPerfEventName(static_cast<PerfEvent>(i)), static_cast<double>(sample.values[i]), result);
+			}
+		}
+		if (sample.IsAvailable(PerfEvent::CYCLES) && sample.IsAvailable(PerfEvent::INSTRUCTIONS) && sample.Get(PerfEvent::CYCLES) > 0) {
+			out << ", ipc = "s << static_cast<double>(sample.Get(PerfEvent::INSTRUCTIONS)) / static_cast<double>(sample.Get(PerfEvent::CYCLES));
+		}
+		out << '\n';
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "document_reordering.h"
+#include "index_arena.h"
+#include "memory_accounting.h"
+#include "perf_counters.h"
+#include "query_trace.h"
+
+// Микробенчмарк горячих путей SearchServer на синтетическом корпусе:
+// слова документов и запросов выбираются по закону Ципфа из словаря.
+// Каждый путь замеряется целиком с таймером и счётчиками PerfCounters,
+// из повторов берётся медианный по времени
+struct BenchmarkOptions {
+	size_t document_count = 20000;
+	size_t words_per_document = 32;
+	size_t vocabulary_size = 20000;
+	size_t query_count = 1000;
+	size_t words_per_query = 3;
+	size_t repeat_count = 5;
+	uint64_t seed = 1;
+	IndexAllocation allocation = IndexAllocation::HEAP;
+};
+
+struct BenchmarkResult {
+	std::string name;
+	// Запросы или документы
+	size_t operations = 0;
+	// Вхождения слов: для поиска — суммарная длина списков вхождений слов
+	// запроса, для разбора и индексации — число слов
+	size_t postings = 0;
+	PerfSample sample;
+};
+
+struct BenchmarkReport {
+	IndexAllocation allocation = IndexAllocation::HEAP;
+	// Память индекса после добавления всех документов
+	MemoryStats memory;
+	// Перенумерация слотов после поиска, перед удалением документов
+	DocumentReorderStats reorder;
+	// split_into_words, add_document, parse_query, find_top_documents_seq,
+	// find_top_documents_par, reorder_documents, find_top_documents_reordered,
+	// remove_document
+	std::vector<BenchmarkResult> results;
+};
+
+BenchmarkReport RunSearchBenchmarks(const BenchmarkOptions& options = {});
+
+// TEXT — строка на путь со значениями на операцию и на вхождение, недоступные
+// счётчики пропускаются. JSON — объект на строку с итоговыми значениями,
+// недоступные счётчики равны null; первая строка — память индекса
+void WriteBenchmarkReport(std::ostream& out, const BenchmarkReport& report, StatsFormat format = StatsFormat::TEXT);
@@ -0,0 +1,44 @@
+#include "search_limits.h"
+
+using namespace std;
+
+CancellationToken::CancellationToken()
+	: cancelled_(make_shared<atomic_bool>(false))
+{
+}
+
+void CancellationToken::Cancel() const
+{
+	cancelled_->store(true, memory_order_relaxed);
+}
+
+bool CancellationToken::IsCancelled() const
+{
+	return cancelled_->load(memory_order_relaxed);
+}
+
+SearchLimits::SearchLimits(Clock::time_point deadline, CancellationToken token)
+	: deadline_(deadline)
+	, token_(move(token))
+{
+}
+
+SearchLimits::SearchLimits(Clock::duration timeout, CancellationToken token)
+	: SearchLimits(Clock::now() + timeout, move(token))
+{
+}
+
+bool SearchLimits::IsExhausted() const
+{
+	return token_.IsCancelled() || Clock::now() >= deadline_;
+}
+
+SearchLimits::Clock::time_point SearchLimits::GetDeadline() const
+{
+	return deadline_;
+}
+
+const CancellationToken& SearchLimits::GetToken() const
+{
+	return token_;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#include "document.h"
+
+// Токен отмены поиска: копии разделяют одно состояние,
+// поэтому отменить запрос можно из любого потока
+class CancellationToken {
+public:
+	CancellationToken();
+
+	void Cancel() const;
+	bool IsCancelled() const;
+
+private:
+	std::shared_ptr<std::atomic_bool> cancelled_;
+};
+
+// Ограничения поиска по времени: срок и токен отмены.
+// Проверяются при подсчёте релевантности через каждые CHECK_INTERVAL вхождений
+class SearchLimits {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static const size_t CHECK_INTERVAL = 4096;
+
+	explicit SearchLimits(Clock::time_point deadline, CancellationToken token = {});
+	explicit SearchLimits(Clock::duration timeout, CancellationToken token = {});
+
+	bool IsExhausted() const;
+
+	Clock::time_point GetDeadline() const;
+	const CancellationToken& GetToken() const;
+
+private:
+	Clock::time_point deadline_;
+	CancellationToken token_;
+};
+
+// Результат поиска с ограничениями. Если поиск прерван, documents — лучшие
+// из документов, релевантность которых подсчитана по просмотренным вхождениям
+struct SearchResult {
+	std::vector<Document> documents;
+	bool is_complete = true;
+};
@@ -2,57 +2,466 @@
 
 using namespace std;
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text))
+template <typename Traits>
+BasicSearchServer<Traits>::BasicSearchServer(const std::string& stop_words_text, IndexAllocation allocation)
+	: BasicSearchServer(typename Traits::Tokenizer{}(stop_words_text), allocation)
 {
 }
 
-SearchServer::SearchServer(const std::string_view stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text))
+template <typename Traits>
+BasicSearchServer<Traits>::BasicSearchServer(const std::string_view stop_words_text, IndexAllocation allocation)
+	: BasicSearchServer(typename Traits::Tokenizer{}(stop_words_text), allocation)
 {
 }
 
-void SearchServer::AddDocument(
+template <typename Traits>
+void BasicSearchServer<Traits>::AddDocument(
 	int document_id,
 	const std::string_view document,
 	DocumentStatus status,
 	const vector<int>& ratings)
+{
+	CheckNewDocumentId(document_id);
+	vector<WordFrequency> word_frequencies = ComputeWordFrequencies(SplitIntoWordsNoStop(document));
+	ReserveDocumentMemory(document.size(), word_frequencies);
+	const auto [doc_it, _] = documents_words_.insert(
+		CountedString(document, DocumentTexts::allocator_type(&memory_->document_texts)));
+
+	// Слова должны ссылаться на сохранённую копию текста
+	for (auto& [word, _] : word_frequencies) {
+		word = string_view(doc_it->data() + (word.data() - document.data()), word.size());
+	}
+	IndexDocument(document_id, word_frequencies, status, ComputeAverageRating(ratings));
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::AddExternalDocument(
+	int document_id,
+	const std::string_view document,
+	DocumentStatus status,
+	const std::vector<int>& ratings)
+{
+	CheckNewDocumentId(document_id);
+	const vector<WordFrequency> word_frequencies = ComputeWordFrequencies(SplitIntoWordsNoStop(document));
+	ReserveDocumentMemory(0, word_frequencies);
+	IndexDocument(document_id, word_frequencies, status, ComputeAverageRating(ratings));
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::AddExternalDocuments(
+	const std::execution::parallel_policy& policy,
+	const std::vector<ExternalDocument>& documents)
+{
+	struct ParsedDocument {
+		vector<WordFrequency> word_frequencies;
+		exception_ptr error;
+	};
+
+	// Разбор на слова не меняет индекс и выполняется параллельно,
+	// вставка в индекс — последовательно, в исходном порядке документов
+	vector<ParsedDocument> parsed(documents.size());
+	const auto parse = [this](const ExternalDocument& document) {
+		ParsedDocument result;
+		try {
+			result.word_frequencies = ComputeWordFrequencies(SplitIntoWordsNoStop(document.text));
+		}
+		catch (...) {
+			result.error = current_exception();
+		}
+		return result;
+	};
+	size_t text_size = 0;
+	for (const ExternalDocument& document : documents) {
+		text_size += document.text.size();
+	}
+	if (ShouldParallelize(text_size)) {
+		transform(policy, documents.begin(), documents.end(), parsed.begin(), parse);
+	}
+	else {
+		transform(documents.begin(), documents.end(), parsed.begin(), parse);
+	}
+
+	for (size_t i = 0; i < documents.size(); ++i) {
+		if (parsed[i].error) {
+			rethrow_exception(parsed[i].error);
+		}
+		CheckNewDocumentId(documents[i].id);
+		ReserveDocumentMemory(0, parsed[i].word_frequencies);
+		IndexDocument(documents[i].id, parsed[i].word_frequencies, documents[i].status, ComputeAverageRating(documents[i].ratings));
+	}
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::KeepAlive(std::shared_ptr<const void> storage)
+{
+	external_storage_.push_back(move(storage));
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::CheckNewDocumentId(int document_id) const
 {
 	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
 		throw invalid_argument("Invalid document_id"s);
 	}
-	const auto [doc_it, _] = documents_words_.insert(string{ document });
+}
 
-	const vector<string_view> words = SplitIntoWordsNoStop(*doc_it);
+template <typename Traits>
+std::vector<WordFrequency> BasicSearchServer<Traits>::ComputeWordFrequencies(const std::vector<std::string_view>& words)
+{
 	const double inv_word_count = 1.0 / words.size();
-	const int raiting = ComputeAverageRating(ratings);
-	DocumentData word_frequencies{ raiting, status, {} };
 
-	for (const std::string_view& word : words) {
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		word_frequencies.words[word] += inv_word_count;
+	vector<string_view> sorted_words(words);
+	sort(sorted_words.begin(), sorted_words.end());
+	vector<WordFrequency> word_frequencies;
+	for (const std::string_view& word : sorted_words) {
+		if (word_frequencies.empty() || word_frequencies.back().first != word) {
+			word_frequencies.push_back({ word, 0.0 });
+		}
+		word_frequencies.back().second += inv_word_count;
+	}
+	return word_frequencies;
+}
+
+template <typename Traits>
+size_t BasicSearchServer<Traits>::EstimateDocumentMemory(size_t text_size, const std::vector<WordFrequency>& word_frequencies) const
+{
+	using WordNode = CountedMap<string_view, PostingList>::value_type;
+	using DocumentNode = typename DocumentMap::value_type;
+
+	size_t bytes = forward_index_.AppendCost(word_frequencies.size())
+		+ attributes_.AppendCost()
+		+ ::AppendCost(documents_id_, 1)
+		+ sizeof(DocumentNode) + TREE_NODE_OVERHEAD;
+	if (text_size > 0) {
+		bytes += sizeof(CountedString) + TREE_NODE_OVERHEAD + text_size + 1;
+	}
+	for (const auto& [word, _] : word_frequencies) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it == word_to_document_freqs_.end()) {
+			const size_t copies = index_layout_ == IndexLayout::IMPACT_ORDERED ? 2 : 1;
+			bytes += sizeof(WordNode) + TREE_NODE_OVERHEAD + copies * (sizeof(uint32_t) + sizeof(double))
+				+ term_dictionary_.AppendCost(word);
+		}
+		else {
+			bytes += it->second.AppendCost();
+		}
+	}
+	return bytes;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::ReserveDocumentMemory(size_t text_size, const std::vector<WordFrequency>& word_frequencies)
+{
+	if (memory_budget_ == 0) {
+		return;
+	}
+	if (GetMemoryStats().Total() + EstimateDocumentMemory(text_size, word_frequencies) <= memory_budget_) {
+		return;
 	}
-	documents_.emplace(document_id, move(word_frequencies));
+	if (index_has_garbage_) {
+		CompactIndex();
+		if (GetMemoryStats().Total() + EstimateDocumentMemory(text_size, word_frequencies) <= memory_budget_) {
+			return;
+		}
+	}
+	throw MemoryBudgetExceeded("Document does not fit into the memory budget"s);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::IndexDocument(
+	int document_id,
+	const std::vector<WordFrequency>& word_frequencies,
+	DocumentStatus status,
+	int rating)
+{
+	const uint32_t slot = static_cast<uint32_t>(attributes_.size());
+	for (const auto& [word, term_freq] : word_frequencies) {
+		const auto [it, inserted] = word_to_document_freqs_.try_emplace(word, &memory_->inverted_index);
+		if (inserted) {
+			term_dictionary_.Insert(it->first, &it->second);
+			if (index_layout_ == IndexLayout::IMPACT_ORDERED) {
+				it->second.SetImpactOrdered(true);
+			}
+		}
+		it->second.Add(slot, term_freq);
+	}
+	attributes_.Add(document_id, rating, status);
+	documents_.emplace(document_id, DocumentData{ slot, forward_index_.Add(word_frequencies) });
 	documents_id_.push_back(document_id);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(
+template <typename Traits>
+void BasicSearchServer<Traits>::SetScoreType(ScoreType score_type, bool validate)
+{
+	if (!is_void_v<typename Traits::Score> && score_type != score_type_) {
+		throw invalid_argument("Score type is fixed by server traits"s);
+	}
+	score_type_ = score_type;
+	validate_scores_ = validate;
+}
+
+template <typename Traits>
+ScoreType BasicSearchServer<Traits>::GetScoreType() const
+{
+	return score_type_;
+}
+
+template <typename Traits>
+QueryStats BasicSearchServer<Traits>::GetQueryCounters() const
+{
+	return query_counters_.Snapshot();
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::ResetQueryCounters()
+{
+	query_counters_.Reset();
+}
+
+template <typename Traits>
+MemoryStats BasicSearchServer<Traits>::GetMemoryStats() const
+{
+	MemoryStats stats;
+	stats.document_texts = memory_->document_texts.Bytes();
+	stats.inverted_index = memory_->inverted_index.Bytes();
+	stats.forward_index = memory_->forward_index.Bytes();
+	stats.documents = memory_->documents.Bytes() + documents_id_.capacity() * sizeof(int);
+	stats.budget = memory_budget_;
+	if (memory_->arena != nullptr) {
+		stats.index_arena = memory_->arena->GetStats().mapped_bytes;
+	}
+	return stats;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SetMemoryBudget(size_t bytes)
+{
+	memory_budget_ = bytes;
+}
+
+template <typename Traits>
+size_t BasicSearchServer<Traits>::GetMemoryBudget() const
+{
+	return memory_budget_;
+}
+
+template <typename Traits>
+IndexAllocation BasicSearchServer<Traits>::GetIndexAllocation() const
+{
+	return memory_->arena != nullptr ? IndexAllocation::HUGE_PAGES : IndexAllocation::HEAP;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SetAdaptiveExecution(bool enabled)
+{
+	adaptive_execution_ = enabled;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsAdaptiveExecution() const
+{
+	return adaptive_execution_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SetIndexLayout(IndexLayout layout)
+{
+	if (layout == index_layout_) {
+		return;
+	}
+	index_layout_ = layout;
+	for (auto& [_, postings] : word_to_document_freqs_) {
+		postings.SetImpactOrdered(layout == IndexLayout::IMPACT_ORDERED);
+	}
+}
+
+template <typename Traits>
+IndexLayout BasicSearchServer<Traits>::GetIndexLayout() const
+{
+	return index_layout_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SetMaxTermExpansions(size_t max_expansions)
+{
+	if (max_expansions == 0) {
+		throw invalid_argument("Max term expansions must be positive"s);
+	}
+	max_term_expansions_ = max_expansions;
+}
+
+template <typename Traits>
+size_t BasicSearchServer<Traits>::GetMaxTermExpansions() const
+{
+	return max_term_expansions_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::CompactIndex()
+{
+	if (attributes_.GetFreeCount() > 0) {
+		CompactSlots();
+	}
+	if (forward_index_.HasGarbage()) {
+		forward_index_.Compact([this](auto on_range) {
+			for (auto& [_, data] : documents_) {
+				on_range(data.words);
+			}
+			});
+	}
+	for (auto& [_, postings] : word_to_document_freqs_) {
+		postings.ShrinkToFit();
+	}
+	documents_id_.shrink_to_fit();
+	index_has_garbage_ = false;
+}
+
+template <typename Traits>
+DocumentReorderStats BasicSearchServer<Traits>::ReorderDocuments(const DocumentReorderOptions& options)
+{
+	DocumentReorderStats stats;
+	stats.slots_before = attributes_.size();
+	stats.gap_bits_before = ComputeAverageGapBits();
+	stats.memory_before = GetMemoryStats();
+
+	// Документы нумеруются в порядке текущих слотов
+	const uint32_t NO_DOCUMENT = numeric_limits<uint32_t>::max();
+	vector<uint32_t> old_slots;
+	old_slots.reserve(documents_.size());
+	vector<uint32_t> slot_documents(attributes_.size(), NO_DOCUMENT);
+	for (uint32_t slot = 0; slot < attributes_.size(); ++slot) {
+		if (attributes_.GetId(slot) != DocumentAttributes::FREE_SLOT_ID) {
+			slot_documents[slot] = static_cast<uint32_t>(old_slots.size());
+			old_slots.push_back(slot);
+		}
+	}
+
+	// Матрица строится по спискам вхождений. Слово одного документа
+	// на порядок не влияет и в неё не входит, вхождения удалённых пропускаются
+	DocumentTermMatrix matrix;
+	matrix.offsets.assign(old_slots.size() + 1, 0);
+	for (const auto& [_, postings] : word_to_document_freqs_) {
+		if (postings.GetDocumentCount() < 2) {
+			continue;
+		}
+		++matrix.term_count;
+		for (size_t i = 0; i < postings.size(); ++i) {
+			const uint32_t document = slot_documents[postings.Slots()[i]];
+			if (document != NO_DOCUMENT) {
+				++matrix.offsets[document + 1];
+			}
+		}
+	}
+	partial_sum(matrix.offsets.begin(), matrix.offsets.end(), matrix.offsets.begin());
+	matrix.terms.resize(matrix.offsets.back());
+	vector<size_t> positions(matrix.offsets.begin(), matrix.offsets.end() - 1);
+	uint32_t term = 0;
+	for (const auto& [_, postings] : word_to_document_freqs_) {
+		if (postings.GetDocumentCount() < 2) {
+			continue;
+		}
+		for (size_t i = 0; i < postings.size(); ++i) {
+			const uint32_t document = slot_documents[postings.Slots()[i]];
+			if (document != NO_DOCUMENT) {
+				matrix.terms[positions[document]++] = term;
+			}
+		}
+		++term;
+	}
+
+	const vector<uint32_t> order = ComputeLocalityOrder(matrix, options);
+	vector<uint32_t> reordered_slots(order.size());
+	for (uint32_t slot = 0; slot < order.size(); ++slot) {
+		reordered_slots[slot] = old_slots[order[slot]];
+	}
+	RenumberSlots(reordered_slots);
+	CompactIndex();
+
+	stats.slots_after = attributes_.size();
+	stats.gap_bits_after = ComputeAverageGapBits();
+	stats.memory_after = GetMemoryStats();
+	return stats;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RenumberSlots(const std::vector<uint32_t>& old_slots)
+{
+	vector<uint32_t> new_slots(attributes_.size(), PostingList::NO_SLOT);
+	for (uint32_t slot = 0; slot < old_slots.size(); ++slot) {
+		new_slots[old_slots[slot]] = slot;
+	}
+	for (auto& [_, postings] : word_to_document_freqs_) {
+		postings.Renumber(new_slots);
+	}
+	attributes_.Reorder(old_slots);
+	vector<DocumentData*> slot_data(old_slots.size());
+	for (auto& [_, data] : documents_) {
+		data.slot = new_slots[data.slot];
+		slot_data[data.slot] = &data;
+	}
+	// Слова документов в прямом индексе тоже идут в порядке слотов
+	forward_index_.Compact([&slot_data](auto on_range) {
+		for (DocumentData* data : slot_data) {
+			on_range(data->words);
+		}
+		});
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::CompactSlots()
+{
+	vector<uint32_t> old_slots;
+	old_slots.reserve(attributes_.size() - attributes_.GetFreeCount());
+	for (uint32_t slot = 0; slot < attributes_.size(); ++slot) {
+		if (!attributes_.IsFree(slot)) {
+			old_slots.push_back(slot);
+		}
+	}
+	RenumberSlots(old_slots);
+}
+
+template <typename Traits>
+double BasicSearchServer<Traits>::ComputeAverageGapBits() const
+{
+	size_t bits = 0;
+	size_t posting_count = 0;
+	for (const auto& [_, postings] : word_to_document_freqs_) {
+		bits += CountGapBits(postings.Slots(), postings.size());
+		posting_count += postings.size();
+	}
+	return posting_count == 0 ? 0.0 : static_cast<double>(bits) / static_cast<double>(posting_count);
+}
+
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::string_view raw_query,
 	DocumentStatus status) const
 {
-	return FindTopDocuments(raw_query,
-		[status](int document_id, DocumentStatus document_status, int rating)
-		{
-			return document_status == status;
-		});
+	return FindTopDocuments(raw_query, DocumentFilter::Status(status));
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(const std::string_view raw_query) const
 {
 	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(
+template <typename Traits>
+std::vector<std::vector<Document>> BasicSearchServer<Traits>::FindTopDocumentsBatch(
+	const std::vector<std::string>& raw_queries,
+	DocumentStatus status) const
+{
+	return FindTopDocumentsBatch(raw_queries, DocumentFilter::Status(status));
+}
+
+template <typename Traits>
+std::vector<std::vector<Document>> BasicSearchServer<Traits>::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const
+{
+	return FindTopDocumentsBatch(raw_queries, DocumentStatus::ACTUAL);
+}
+
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::execution::sequenced_policy& policy,
 	const std::string_view raw_query,
 	DocumentStatus status) const
@@ -60,68 +469,120 @@ std::vector<Document> SearchServer::FindTopDocuments(
 	return FindTopDocuments(raw_query, status);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::execution::sequenced_policy& policy,
 	const std::string_view raw_query) const
 {
 	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::execution::parallel_policy& policy,
 	const std::string_view raw_query,
 	DocumentStatus status) const
 {
-	return FindTopDocuments(policy, raw_query,
-		[status](int document_id, DocumentStatus document_status, int rating)
-		{
-			return document_status == status;
-		});
+	return FindTopDocuments(policy, raw_query, DocumentFilter::Status(status));
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::execution::parallel_policy& policy, 
 	const std::string_view raw_query) const
 {
 	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
-int SearchServer::GetDocumentCount() const 
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsPage(
+	const std::string_view raw_query,
+	size_t page_number,
+	size_t page_size,
+	DocumentStatus status) const
 {
-	return documents_.size();
+	return FindTopDocumentsPage(raw_query, page_number, page_size, DocumentFilter::Status(status));
 }
 
-tuple<vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
-	const std::string_view& raw_query, 
-	int document_id) const 
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsPage(
+	const std::string_view raw_query,
+	size_t page_number,
+	size_t page_size) const
 {
-	const auto query = ParseQuery(raw_query);
-	vector<string_view> matched_words;
+	return FindTopDocumentsPage(raw_query, page_number, page_size, DocumentStatus::ACTUAL);
+}
 
-	for (const std::string_view word : query.minus_words) {
-		auto it = word_to_document_freqs_.find(word);
-		if (it == word_to_document_freqs_.end()) {
-			continue;
-		}
-		if (it->second.count(document_id)) {
-			return { matched_words, documents_.at(document_id).status };
-		}
-	}
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsAfter(
+	const std::string_view raw_query,
+	const Document& last_document,
+	size_t page_size,
+	DocumentStatus status) const
+{
+	return FindTopDocumentsAfter(raw_query, last_document, page_size, DocumentFilter::Status(status));
+}
 
-	for (const string_view word : query.plus_words) {
-		auto it = word_to_document_freqs_.find(word);
-		if (it == word_to_document_freqs_.end()) {
-			continue;
-		}
-		if (it->second.count(document_id)) {
-			matched_words.push_back(word);
-		}
-	}
+template <typename Traits>
+std::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsAfter(
+	const std::string_view raw_query,
+	const Document& last_document,
+	size_t page_size) const
+{
+	return FindTopDocumentsAfter(raw_query, last_document, page_size, DocumentStatus::ACTUAL);
+}
+
+template <typename Traits>
+SearchResult BasicSearchServer<Traits>::FindTopDocumentsWithin(
+	const std::string_view raw_query,
+	DocumentStatus status,
+	const SearchLimits& limits) const
+{
+	return FindTopDocumentsWithin(raw_query, DocumentFilter::Status(status), limits);
+}
+
+template <typename Traits>
+SearchResult BasicSearchServer<Traits>::FindTopDocumentsWithin(
+	const std::string_view raw_query,
+	const SearchLimits& limits) const
+{
+	return FindTopDocumentsWithin(raw_query, DocumentStatus::ACTUAL, limits);
+}
+
+template <typename Traits>
+std::future<SearchResult> BasicSearchServer<Traits>::FindTopDocumentsAsync(
+	std::string raw_query,
+	DocumentStatus status,
+	SearchLimits limits) const
+{
+	return FindTopDocumentsAsync(move(raw_query), DocumentFilter::Status(status), move(limits));
+}
 
-	return { matched_words, documents_.at(document_id).status };
+template <typename Traits>
+std::future<SearchResult> BasicSearchServer<Traits>::FindTopDocumentsAsync(
+	std::string raw_query,
+	SearchLimits limits) const
+{
+	return FindTopDocumentsAsync(move(raw_query), DocumentStatus::ACTUAL, move(limits));
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(
+template <typename Traits>
+int BasicSearchServer<Traits>::GetDocumentCount() const 
+{
+	return documents_.size();
+}
+
+template <typename Traits>
+tuple<vector<std::string_view>, DocumentStatus> BasicSearchServer<Traits>::MatchDocument(
+	const std::string_view& raw_query, 
+	int document_id) const 
+{
+	const QueryArena::Scope arena;
+	return MatchQuery(ParseQuery(raw_query, arena.Resource(), false), document_id);
+}
+
+template <typename Traits>
+std::tuple<std::vector<std::string_view>, DocumentStatus> BasicSearchServer<Traits>::MatchDocument(
 	const std::execution::sequenced_policy& policy,
 	const std::string_view& raw_query,
 	int document_id) const
@@ -129,59 +590,180 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 	return MatchDocument(raw_query, document_id);
 }
 
-std::tuple<std::vector<string_view>, DocumentStatus> SearchServer::MatchDocument(
+// Для одного документа параллельный обход слов запроса не окупается,
+// параллелизм есть в пакетной версии MatchDocuments
+template <typename Traits>
+std::tuple<std::vector<string_view>, DocumentStatus> BasicSearchServer<Traits>::MatchDocument(
 	const std::execution::parallel_policy& policy,
 	const std::string_view& raw_query,
 	int document_id) const
 {
-	const auto query = ParseQuery(raw_query);
-	vector<string_view> matched_words(query.plus_words.size());
+	return MatchDocument(raw_query, document_id);
+}
 
-	for (const std::string_view word : query.minus_words) {
-		auto it = word_to_document_freqs_.find(word);
-		if (it == word_to_document_freqs_.end()) {
-			continue;
-		}
-		if (it->second.count(document_id)) {
-			matched_words.clear();
-			return { matched_words, documents_.at(document_id).status };
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::MatchResult> BasicSearchServer<Traits>::MatchDocuments(
+	const std::string_view raw_query,
+	const std::vector<int>& document_ids) const
+{
+	const QueryArena::Scope arena;
+	const auto query = ParseQuery(raw_query, arena.Resource(), false);
+	vector<MatchResult> result;
+	result.reserve(document_ids.size());
+	// Документ ищется на шаг раньше, чтобы его слова и атрибуты
+	// загружались из памяти, пока сопоставляется предыдущий
+	const DocumentData* next = document_ids.empty() ? nullptr : &documents_.at(document_ids.front());
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		const DocumentData& document = *next;
+		if (i + 1 < document_ids.size()) {
+			next = &documents_.at(document_ids[i + 1]);
+			forward_index_.Prefetch(next->words);
+			attributes_.Prefetch(next->slot);
 		}
+		result.push_back(MatchQuery(query, document));
 	}
+	return result;
+}
 
-	atomic_size_t count = 0;
-	for_each(policy,
-		query.plus_words.begin(), query.plus_words.end(),
-		[this, document_id, &count, &matched_words](const string_view word) {
-			auto it = documents_.find(document_id);
-			if (it != documents_.end()) {
-				if (it->second.words.count(word)) {
-					matched_words[++count] = word;
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::MatchResult> BasicSearchServer<Traits>::MatchDocuments(
+	const std::execution::sequenced_policy& policy,
+	const std::string_view raw_query,
+	const std::vector<int>& document_ids) const
+{
+	return MatchDocuments(raw_query, document_ids);
+}
+
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::MatchResult> BasicSearchServer<Traits>::MatchDocuments(
+	const std::execution::parallel_policy& policy,
+	const std::string_view raw_query,
+	const std::vector<int>& document_ids) const
+{
+	const QueryArena::Scope arena;
+	const auto query = ParseQuery(raw_query, arena.Resource(), false);
+	if (!ShouldParallelize(document_ids.size() * (query.plus_words.size() + query.minus_words.size() + 1))) {
+		return MatchDocuments(raw_query, document_ids);
+	}
+	vector<MatchResult> result(document_ids.size());
+	transform(policy,
+		document_ids.begin(), document_ids.end(),
+		result.begin(),
+		[this, &query](const int document_id) {
+			return MatchQuery(query, document_id);
+		});
+	return result;
+}
+
+// Слова запроса и слова документа упорядочены одинаково, поэтому пересечение
+// считается слиянием с галопирующим поиском по словам документа.
+// Найденные слова ссылаются на текст документа, а не на текст запроса
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchQuery(const Query& query, int document_id) const
+{
+	return MatchQuery(query, documents_.at(document_id));
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchQuery(const Query& query, const DocumentData& document) const
+{
+	const DocumentStatus status = attributes_.GetStatus(document.slot);
+	const WordFrequencies words = forward_index_.Get(document.words);
+	vector<string_view> matched_words;
+
+	const auto intersect = [&words](const pmr::vector<string_view>& query_words, auto on_match) {
+		const auto less = [](const WordFrequency& lhs, string_view rhs) {
+			return lhs.first < rhs;
+		};
+		auto first = words.begin();
+		for (const string_view word : query_words) {
+			if (IsWordPattern(word)) {
+				continue;
+			}
+			size_t step = 1;
+			auto last = first;
+			while (last != words.end() && last->first < word) {
+				first = last;
+				last = (static_cast<size_t>(words.end() - last) > step) ? last + step : words.end();
+				step *= 2;
+			}
+			first = lower_bound(first, last, word, less);
+			if (first == words.end()) {
+				return;
+			}
+			if (first->first == word && !on_match(first->first)) {
+				return;
+			}
+		}
+	};
+
+	// Шаблону соответствуют слова документа из его раскрытия
+	const auto match_patterns = [&](const pmr::vector<string_view>& query_words, auto on_match) {
+		for (const string_view pattern : query_words) {
+			const TermExpansion* expansion = FindExpansion(query, pattern);
+			if (expansion == nullptr) {
+				continue;
+			}
+			for (const auto& [word, _] : words) {
+				if (MatchesWordPattern(pattern, word)
+					&& count(expansion->sources.begin(), expansion->sources.end(), &word_to_document_freqs_.find(word)->second) > 0
+					&& !on_match(word)) {
+					return;
 				}
 			}
 		}
-	);
+	};
+
+	bool has_minus_word = false;
+	const auto on_minus_word = [&has_minus_word](string_view) {
+		has_minus_word = true;
+		return false;
+	};
+	intersect(query.minus_words, on_minus_word);
+	if (!has_minus_word && !query.expansions.empty()) {
+		match_patterns(query.minus_words, on_minus_word);
+	}
+	if (has_minus_word) {
+		return { move(matched_words), status };
+	}
 
-	matched_words.resize(count);
-	return { matched_words, documents_.at(document_id).status };
+	// Слова собираются в буфер потока, чтобы результат выделялся один раз
+	thread_local vector<string_view> found_words;
+	found_words.clear();
+	const auto on_plus_word = [](string_view word) {
+		found_words.push_back(word);
+		return true;
+	};
+	intersect(query.plus_words, on_plus_word);
+	if (!query.expansions.empty()) {
+		match_patterns(query.plus_words, on_plus_word);
+		sort(found_words.begin(), found_words.end());
+		found_words.erase(unique(found_words.begin(), found_words.end()), found_words.end());
+	}
+	matched_words.assign(found_words.begin(), found_words.end());
+	return { move(matched_words), status };
 }
 
 
-bool SearchServer::IsStopWord(const string_view word) const 
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsStopWord(const string_view word) const 
 {
-	return stop_words_.count(string{ word }) == 1;
+	return stop_words_.count(word) == 1;
 }
 
-bool SearchServer::IsValidWord(const std::string_view word) 
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsValidWord(const std::string_view word) 
 {
 	return none_of(word.begin(), word.end(), [](const char c) {
 		return c >= '\0' && c < ' ';
 		});
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const 
+template <typename Traits>
+vector<string_view> BasicSearchServer<Traits>::SplitIntoWordsNoStop(const std::string_view text) const 
 {
 	vector<string_view> words;
-	for (string_view word : SplitIntoWords(text)) {
+	for (string_view word : tokenizer_(text)) {
 		if (!IsValidWord(word)) {
 			throw invalid_argument("Word "s + string{ text } + " is invalid"s);
 		}
@@ -192,7 +774,8 @@ vector<string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view te
 	return words;
 }
 
-int SearchServer::ComputeAverageRating(const vector<int>& ratings) 
+template <typename Traits>
+int BasicSearchServer<Traits>::ComputeAverageRating(const vector<int>& ratings) 
 {
 	if (ratings.empty()) {
 		return 0;
@@ -204,7 +787,8 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings)
 	return rating_sum / static_cast<int>(ratings.size());
 }
 
-inline SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const 
+template <typename Traits>
+typename BasicSearchServer<Traits>::QueryWord BasicSearchServer<Traits>::ParseQueryWord(const std::string_view text) const 
 {
 	if (text.empty()) {
 		throw invalid_argument("Query word is empty"s);
@@ -218,16 +802,21 @@ inline SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_vi
 	else {
 		word = text;
 	}
-	if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+	// Шаблон с ведущей звёздочкой потребовал бы перебора всего словаря
+	if (word.empty() || word[0] == '-' || word[0] == WORD_PATTERN_WILDCARD || !IsValidWord(word)) {
 		throw invalid_argument("Query word "s + string{ text } + " is invalid");
 	}
 	return { word, is_minus, IsStopWord(word) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const 
+template <typename Traits>
+typename BasicSearchServer<Traits>::Query BasicSearchServer<Traits>::ParseQuery(
+	const std::string_view text,
+	std::pmr::memory_resource* resource,
+	bool merge_patterns) const
 {
-	Query result;
-	vector<string_view> words = SplitIntoWords(text);
+	Query result{ pmr::vector<string_view>(resource), pmr::vector<string_view>(resource), pmr::vector<TermExpansion>(resource) };
+	const pmr::vector<string_view> words = tokenizer_(text, resource);
 
 	for_each(
 		words.begin(), words.end(),
@@ -244,85 +833,347 @@ SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const
 		}
 	);
 
-	sort(execution::par, result.minus_words.begin(), result.minus_words.end());
-	sort(execution::par, result.plus_words.begin(), result.plus_words.end());
+	// Запрос обычно из нескольких слов, и параллельная сортировка
+	// окупается только на очень длинных
+	const auto sort_unique = [](pmr::vector<string_view>& words) {
+		if (ExecutionCostModel::Instance().ShouldParallelize(SortWork(words.size()))) {
+			sort(execution::par, words.begin(), words.end());
+			words.erase(unique(execution::par, words.begin(), words.end()), words.end());
+		}
+		else {
+			sort(words.begin(), words.end());
+			words.erase(unique(words.begin(), words.end()), words.end());
+		}
+	};
+	sort_unique(result.minus_words);
+	sort_unique(result.plus_words);
+
+	for (const auto* words : { &result.plus_words, &result.minus_words }) {
+		for (const string_view word : *words) {
+			if (IsWordPattern(word) && FindExpansion(result, word) == nullptr) {
+				ExpandWordPattern(word, result, merge_patterns);
+			}
+		}
+	}
+	return result;
+}
+
+// Выбираются самые частые слова, чтобы ограничение раскрытия теряло
+// как можно меньше документов. Частоты складываются в накопителе потока
+// в порядке sources, слоты затем упорядочиваются сортировкой кандидатов
+// или, если их много, проходом по всем слотам
+template <typename Traits>
+void BasicSearchServer<Traits>::ExpandWordPattern(std::string_view pattern, Query& query, bool merge_postings) const
+{
+	pmr::memory_resource* resource = query.expansions.get_allocator().resource();
+	pmr::vector<const PostingList*> sources(resource);
+	const auto is_more_frequent = [](const PostingList* lhs, const PostingList* rhs) {
+		return lhs->GetDocumentCount() > rhs->GetDocumentCount();
+	};
+	term_dictionary_.ForEachMatch(pattern, [&](string_view, const PostingList* postings) {
+		if (sources.size() < max_term_expansions_) {
+			sources.push_back(postings);
+			push_heap(sources.begin(), sources.end(), is_more_frequent);
+		}
+		else if (postings->GetDocumentCount() > sources.front()->GetDocumentCount()) {
+			pop_heap(sources.begin(), sources.end(), is_more_frequent);
+			sources.back() = postings;
+			push_heap(sources.begin(), sources.end(), is_more_frequent);
+		}
+		});
 
-	auto end_it_m = unique(execution::par, result.minus_words.begin(), result.minus_words.end());
-	auto end_it_p = unique(execution::par, result.plus_words.begin(), result.plus_words.end());
+	// Объединённый список размещается в арене запроса вместе со своим счётчиком,
+	// который живёт до её сброса
+	MemoryCounter* counter = new (resource->allocate(sizeof(MemoryCounter), alignof(MemoryCounter))) MemoryCounter(resource);
+	TermExpansion& expansion = query.expansions.emplace_back(
+		TermExpansion{ pattern, move(sources), PostingList(counter) });
+	if (!merge_postings || expansion.sources.empty()) {
+		return;
+	}
 
-	result.minus_words.resize(end_it_m - result.minus_words.begin());
-	result.plus_words.resize(end_it_p - result.plus_words.begin());
+	auto& accumulator = Accumulator<double>::ForThread();
+	const size_t slot_count = attributes_.size();
+	accumulator.Reset(slot_count);
+	for (const PostingList* postings : expansion.sources) {
+		AccumulateScores(postings->Slots(), postings->TermFreqs(), postings->size(), 1.0, accumulator.Scores());
+		accumulator.Touch(postings->Slots(), postings->size());
+	}
+	const size_t candidate_count = accumulator.Candidates().size();
+	if (SortWork(candidate_count) < slot_count) {
+		pmr::vector<uint32_t> slots(accumulator.Candidates().begin(), accumulator.Candidates().end(), resource);
+		sort(slots.begin(), slots.end());
+		for (const uint32_t slot : slots) {
+			if (!attributes_.IsFree(slot)) {
+				expansion.postings.Add(slot, accumulator.GetScore(slot));
+			}
+		}
+	}
+	else {
+		// Частота слова в документе положительна, нули — незадетые слоты
+		for (uint32_t slot = 0; slot < slot_count; ++slot) {
+			if (accumulator.GetScore(slot) != 0.0 && !attributes_.IsFree(slot)) {
+				expansion.postings.Add(slot, accumulator.GetScore(slot));
+			}
+		}
+	}
+	if (index_layout_ == IndexLayout::IMPACT_ORDERED) {
+		expansion.postings.SetImpactOrdered(true);
+	}
+}
 
-	return result;
+template <typename Traits>
+const typename BasicSearchServer<Traits>::TermExpansion* BasicSearchServer<Traits>::FindExpansion(const Query& query, std::string_view pattern) const
+{
+	for (const TermExpansion& expansion : query.expansions) {
+		if (expansion.pattern == pattern) {
+			return &expansion;
+		}
+	}
+	return nullptr;
+}
+
+template <typename Traits>
+const PostingList* BasicSearchServer<Traits>::FindPostings(const Query& query, std::string_view word) const
+{
+	if (!query.expansions.empty() && IsWordPattern(word)) {
+		const TermExpansion* expansion = FindExpansion(query, word);
+		return (expansion == nullptr || expansion->postings.empty()) ? nullptr : &expansion->postings;
+	}
+	const auto it = word_to_document_freqs_.find(word);
+	return it == word_to_document_freqs_.end() ? nullptr : &it->second;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::ShouldParallelize(size_t work) const
+{
+	return !adaptive_execution_ || ExecutionCostModel::Instance().ShouldParallelize(work);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SortByDocumentFreq(Query& query) const
+{
+	const auto document_count = [this, &query](string_view word) {
+		const PostingList* postings = FindPostings(query, word);
+		return postings == nullptr ? 0 : postings->GetDocumentCount();
+	};
+	stable_sort(query.plus_words.begin(), query.plus_words.end(), [&document_count](string_view lhs, string_view rhs) {
+		return document_count(lhs) < document_count(rhs);
+		});
+}
+
+// Основная работа поиска — обход списков вхождений слов запроса
+template <typename Traits>
+size_t BasicSearchServer<Traits>::EstimateQueryWork(const Query& query) const
+{
+	size_t work = 0;
+	for (const auto* words : { &query.plus_words, &query.minus_words }) {
+		for (const string_view word : *words) {
+			if (const PostingList* postings = FindPostings(query, word)) {
+				work += postings->size();
+			}
+		}
+	}
+	return work;
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::SlotFilter BasicSearchServer<Traits>::EvaluateSlotFilter(const DocumentFilter& filter, uint64_t* bits) const
+{
+	const size_t word_count = GetSlotFilterWordCount();
+	// Биты за последним слотом остаются нулевыми для подсчёта прошедших
+	fill(bits, bits + word_count, 0);
+	attributes_.EvaluateAll(filter, bits);
+	SlotFilter slot_filter{ bits, 0 };
+	for (size_t i = 0; i < word_count; ++i) {
+		slot_filter.passed_count += static_cast<size_t>(__builtin_popcountll(bits[i]));
+	}
+	return slot_filter;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const 
+template <typename Traits>
+bool BasicSearchServer<Traits>::ShouldEvaluateSlotFilter(const Query& query) const
 {
-	return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+	return EstimateQueryWork(query) * SLOT_FILTER_COST_RATIO >= attributes_.size();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const 
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+	if (std::abs(lhs.relevance - rhs.relevance) >= MIN_RELEVANCE_DIFFERENCE) {
+		return lhs.relevance > rhs.relevance;
+	}
+	if (lhs.rating != rhs.rating) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.id < rhs.id;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::ValidateTopDocuments(
+	const std::pmr::vector<Document>& top_documents,
+	std::pmr::vector<Document> reference_documents) const
+{
+	map<int, double> reference_relevance;
+	for (const Document& document : reference_documents) {
+		reference_relevance[document.id] = document.relevance;
+	}
+	SelectTopDocuments(execution::seq, reference_documents);
+
+	bool valid = top_documents.size() == reference_documents.size();
+	for (size_t i = 0; valid && i < top_documents.size(); ++i) {
+		const auto it = reference_relevance.find(top_documents[i].id);
+		// Перестановка допустима только среди документов с неразличимой релевантностью
+		valid = it != reference_relevance.end()
+			&& std::abs(it->second - top_documents[i].relevance) < MIN_RELEVANCE_DIFFERENCE
+			&& std::abs(it->second - reference_documents[i].relevance) < MIN_RELEVANCE_DIFFERENCE;
+	}
+	if (!valid) {
+		throw logic_error("Top documents differ from double precision reference"s);
+	}
+}
+
+template <typename Traits>
+double BasicSearchServer<Traits>::ComputeWordInverseDocumentFreq(const PostingList& postings) const 
+{
+	return log(GetDocumentCount() * 1.0 / postings.GetDocumentCount());
+}
+
+template <typename Traits>
+WordFrequencies BasicSearchServer<Traits>::GetWordFrequencies(int document_id) const 
 {
 	auto result = documents_.find(document_id);
 	if (result != documents_.end())
 	{
-		return result->second.words;
+		return forward_index_.Get(result->second.words);
 	}
-	static const map<string_view, double> null_map;
-	return null_map;
+	return {};
 }
 
-void SearchServer::RemoveDocument(int document_id) 
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(int document_id) 
 {
 	auto itemIt = documents_.find(document_id);
-	for (auto& [word, _] : itemIt->second.words) {
-		word_to_document_freqs_[word].erase(document_id);
+	for (auto& [word, _] : forward_index_.Get(itemIt->second.words)) {
+		word_to_document_freqs_.find(word)->second.MarkRemoved();
 	}
-	documents_.erase(itemIt);
-	documents_id_.erase(find(documents_id_.begin(), documents_id_.end(), document_id));
+	RemoveDocumentFromIndex(itemIt);
 }
 
-void SearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) 
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) 
 {
 	RemoveDocument(document_id);
 }
 
-void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) 
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) 
 {
 	auto itemIt = documents_.find(document_id);
+	const WordFrequencies words = forward_index_.Get(itemIt->second.words);
 
-	vector<string_view> words(itemIt->second.words.size());
+	// Удаление из списка вхождений — поиск слова в словаре
+	if (!ShouldParallelize(words.size())) {
+		RemoveDocument(document_id);
+		return;
+	}
 
-	transform(execution::par, itemIt->second.words.begin(), itemIt->second.words.end(), words.begin(),
-		[](pair<const string_view, double>& word) {
-			return word.first;
+	for_each(policy, words.begin(), words.end(),
+		[this](const WordFrequency& word) {
+			word_to_document_freqs_.find(word.first)->second.MarkRemoved();
 		});
 
-	for_each(execution::par, words.begin(), words.end(),
-		[this, document_id](const string_view word) {
-			word_to_document_freqs_.find(word)->second.erase(document_id);
-		});
+	RemoveDocumentFromIndex(itemIt);
+}
 
-	documents_.erase(itemIt);
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocuments(const std::vector<int>& document_ids)
+{
+	size_t removed_count = 0;
+	for (const int document_id : document_ids) {
+		const auto document = documents_.find(document_id);
+		if (document == documents_.end()) {
+			continue;
+		}
+		for (auto& [word, _] : forward_index_.Get(document->second.words)) {
+			word_to_document_freqs_.find(word)->second.MarkRemoved();
+		}
+		EraseDocument(document);
+		++removed_count;
+	}
+	if (removed_count == 0) {
+		return;
+	}
+	documents_id_.erase(remove_if(documents_id_.begin(), documents_id_.end(), [this](int document_id) {
+		return documents_.count(document_id) == 0;
+		}), documents_id_.end());
+	CompactAfterRemoval();
+}
+
+// Завершает удаление после того, как документ убран из списков вхождений
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocumentFromIndex(typename DocumentMap::iterator document)
+{
+	const int document_id = document->first;
+	EraseDocument(document);
 	documents_id_.erase(find(documents_id_.begin(), documents_id_.end(), document_id));
+	CompactAfterRemoval();
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::EraseDocument(typename DocumentMap::iterator document)
+{
+	const ForwardIndex::Range words = document->second.words;
+	for (const auto& [word, _] : forward_index_.Get(words)) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it->second.GetDocumentCount() == 0) {
+			term_dictionary_.Erase(word);
+			word_to_document_freqs_.erase(it);
+		}
+	}
+	attributes_.Free(document->second.slot);
+	documents_.erase(document);
+	forward_index_.Remove(words);
+	index_has_garbage_ = true;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::CompactAfterRemoval()
+{
+	if (forward_index_.NeedsCompaction()) {
+		forward_index_.Compact([this](auto on_range) {
+			for (auto& [_, data] : documents_) {
+				on_range(data.words);
+			}
+			});
+	}
+	if (attributes_.GetFreeCount() * 2 >= attributes_.size()) {
+		CompactSlots();
+	}
 }
 
-vector<int>::iterator SearchServer::begin()
+template <typename Traits>
+vector<int>::iterator BasicSearchServer<Traits>::begin()
 {
 	return documents_id_.begin();
 }
 
-vector<int>::iterator SearchServer::end()
+template <typename Traits>
+vector<int>::iterator BasicSearchServer<Traits>::end()
 {
 	return documents_id_.end();
 }
 
-vector<int>::const_iterator SearchServer::begin() const
+template <typename Traits>
+vector<int>::const_iterator BasicSearchServer<Traits>::begin() const
 {
 	return documents_id_.begin();
 }
 
-vector<int>::const_iterator SearchServer::end() const
+template <typename Traits>
+vector<int>::const_iterator BasicSearchServer<Traits>::end() const
 {
 	return documents_id_.end();
-}
\ No newline at end of file
+}
+
+template class BasicSearchServer<DefaultSearchServerTraits>;
+template class BasicSearchServer<CompactSearchServerTraits>;
@@ -4,33 +4,63 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <memory>
+#include <future>
+#include <memory_resource>
 
 #include <iterator>
 #include <algorithm>
+#include <numeric>
 #include <utility>
 #include <stdexcept>
 #include <functional>
+#include <type_traits>
 
 #include <execution>
 #include <atomic>
 
 #include <cmath>
+#include <limits>
+#include <cstdint>
 
 #include "document.h"
 #include "concurrent_map.h"
+#include "document_attributes.h"
+#include "document_reordering.h"
+#include "document_filter.h"
+#include "execution_cost_model.h"
+#include "forward_index.h"
+#include "index_arena.h"
+#include "memory_accounting.h"
+#include "posting_list.h"
+#include "prefetch.h"
+#include "query_arena.h"
+#include "query_trace.h"
+#include "search_limits.h"
+#include "score_accumulator.h"
+#include "score_kernel.h"
+#include "search_server_traits.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
 
-
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double MIN_RELEVANCE_DIFFERENCE = 1e-6;
-const size_t CONCURENT_MAP_BUCKET_COUNT = 100;
-
-class SearchServer {
+// Поисковый сервер с параметрами Traits (см. DefaultSearchServerTraits)
+template <typename Traits>
+class BasicSearchServer {
 public:
+	static constexpr size_t MAX_RESULT_DOCUMENT_COUNT = Traits::MAX_RESULT_DOCUMENT_COUNT;
+	static constexpr double MIN_RELEVANCE_DIFFERENCE = Traits::MIN_RELEVANCE_DIFFERENCE;
+	static constexpr size_t CONCURRENT_MAP_BUCKET_COUNT = Traits::CONCURRENT_MAP_BUCKET_COUNT;
+
+	// С IndexAllocation::HUGE_PAGES списки вхождений, прямой индекс и атрибуты
+	// документов размещаются в IndexArena на больших страницах
 	template <typename StringContainer>
-	explicit SearchServer(const StringContainer& stop_words);
-	explicit SearchServer(const std::string& stop_words_text);
-	explicit SearchServer(const std::string_view stop_words_text);
+	explicit BasicSearchServer(const StringContainer& stop_words, IndexAllocation allocation = IndexAllocation::HEAP);
+	explicit BasicSearchServer(const std::string& stop_words_text, IndexAllocation allocation = IndexAllocation::HEAP);
+	explicit BasicSearchServer(const std::string_view stop_words_text, IndexAllocation allocation = IndexAllocation::HEAP);
+
+	// Контейнеры индекса ссылаются на счётчики памяти сервера
+	BasicSearchServer(BasicSearchServer&&) = default;
+	BasicSearchServer& operator=(BasicSearchServer&&) = delete;
 
 	void AddDocument(
 		int document_id,
@@ -38,6 +68,84 @@ public:
 		DocumentStatus status,
 		const std::vector<int>& ratings);
 
+	// Текст документа не копируется: он должен оставаться доступным,
+	// пока на него ссылается индекс (см. KeepAlive)
+	struct ExternalDocument {
+		int id;
+		std::string_view text;
+		DocumentStatus status;
+		std::vector<int> ratings;
+	};
+
+	void AddExternalDocument(
+		int document_id,
+		const std::string_view document,
+		DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void AddExternalDocuments(
+		const std::execution::parallel_policy& policy,
+		const std::vector<ExternalDocument>& documents);
+
+	// Продлевает время жизни внешнего хранилища текстов до уничтожения сервера
+	void KeepAlive(std::shared_ptr<const void> storage);
+
+	// Тип накопителя релевантности при поиске. С проверкой каждый поиск
+	// в FLOAT повторяется в double, и если порядок топа расходится больше
+	// чем на MIN_RELEVANCE_DIFFERENCE, выбрасывается std::logic_error.
+	// Если тип задан в Traits, другой тип отклоняется std::invalid_argument
+	void SetScoreType(ScoreType score_type, bool validate = false);
+	ScoreType GetScoreType() const;
+
+	// Суммарная статистика запросов с момента создания или сброса.
+	// Заполняется только при сборке с SEARCH_SERVER_TRACING
+	QueryStats GetQueryCounters() const;
+	void ResetQueryCounters();
+
+	// Память структур индекса по данным аллокатора (ёмкость контейнеров,
+	// узлы деревьев, копии текстов); внешние тексты не учитываются
+	MemoryStats GetMemoryStats() const;
+
+	// Ограничение памяти индекса, 0 — без ограничения. Если новый документ
+	// не помещается даже после CompactIndex, добавление отклоняется
+	// исключением MemoryBudgetExceeded, индекс при этом не меняется
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget() const;
+
+	IndexAllocation GetIndexAllocation() const;
+
+	// Возвращает память, оставшуюся от удалённых документов,
+	// и отбрасывает их слоты вместе с вхождениями в списках
+	void CompactIndex();
+
+	// Перенумеровывает внутренние слоты так, чтобы документы с общими словами
+	// шли подряд (ComputeLocalityOrder), и отбрасывает слоты удалённых документов.
+	// Разрывы в списках вхождений сокращаются, накопители и атрибуты обходятся
+	// локальнее. Id документов, порядок begin()/end() и результаты поиска
+	// не меняются. Возвращает память и оценку размера сжатых списков до и после
+	DocumentReorderStats ReorderDocuments(const DocumentReorderOptions& options = {});
+
+	// Перегрузки с execution::par по оценке объёма работы выбирают
+	// последовательный или параллельный путь и число задач
+	// (см. ExecutionCostModel). Без адаптации всегда выполняется параллельный
+	void SetAdaptiveExecution(bool enabled);
+	bool IsAdaptiveExecution() const;
+
+	// В IMPACT_ORDERED последовательный FindTopDocuments обходит вхождения
+	// от больших вкладов в релевантность к меньшим и останавливается, как только
+	// топ больше не может измениться. Результат совпадает с DOCUMENT_ORDERED,
+	// списки вхождений занимают вдвое больше памяти
+	void SetIndexLayout(IndexLayout layout);
+	IndexLayout GetIndexLayout() const;
+
+	// Слово запроса со звёздочкой (hold*, h*ld) раскрывается по словарю
+	// индекса не более чем в max_expansions самых частых подходящих слов.
+	// Шаблон начинается с буквы, слово с ведущей звёздочкой недопустимо.
+	// Их списки вхождений объединяются в один: частоты слов в документе
+	// складываются, IDF считается по числу документов хотя бы с одним словом
+	void SetMaxTermExpansions(size_t max_expansions);
+	size_t GetMaxTermExpansions() const;
+
 	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 	std::vector<Document> FindTopDocuments(
 		const std::string_view raw_query,
@@ -78,6 +186,97 @@ public:
 		const std::string_view raw_query,
 		DocumentPredicate document_predicate) const;
 
+	// Страница выдачи с номером page_number (с нуля) по page_size документов.
+	// Отбираются только первые (page_number + 1) * page_size документов
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsPage(
+		const std::string_view raw_query,
+		size_t page_number,
+		size_t page_size,
+		DocumentPredicate document_predicate) const;
+
+	std::vector<Document> FindTopDocumentsPage(
+		const std::string_view raw_query,
+		size_t page_number,
+		size_t page_size,
+		DocumentStatus status) const;
+
+	std::vector<Document> FindTopDocumentsPage(
+		const std::string_view raw_query,
+		size_t page_number,
+		size_t page_size) const;
+
+	// Следующие page_size документов после last_document в порядке выдачи
+	// (релевантность, рейтинг, id). Памяти нужно O(page_size) на любой глубине
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsAfter(
+		const std::string_view raw_query,
+		const Document& last_document,
+		size_t page_size,
+		DocumentPredicate document_predicate) const;
+
+	std::vector<Document> FindTopDocumentsAfter(
+		const std::string_view raw_query,
+		const Document& last_document,
+		size_t page_size,
+		DocumentStatus status) const;
+
+	std::vector<Document> FindTopDocumentsAfter(
+		const std::string_view raw_query,
+		const Document& last_document,
+		size_t page_size) const;
+
+	// Поиск с ограничением по времени и отменой. Слова запроса обходятся
+	// от редких к частым; если ограничение сработало, возвращаются лучшие
+	// документы по уже просмотренным вхождениям и is_complete == false.
+	// Минус-слова и фильтр применяются всегда
+	template <typename DocumentPredicate>
+	SearchResult FindTopDocumentsWithin(
+		const std::string_view raw_query,
+		DocumentPredicate document_predicate,
+		const SearchLimits& limits) const;
+
+	SearchResult FindTopDocumentsWithin(
+		const std::string_view raw_query,
+		DocumentStatus status,
+		const SearchLimits& limits) const;
+
+	SearchResult FindTopDocumentsWithin(
+		const std::string_view raw_query,
+		const SearchLimits& limits) const;
+
+	// Асинхронный вариант FindTopDocumentsWithin в отдельном потоке.
+	// Сервер не должен изменяться или уничтожаться до получения результата
+	template <typename DocumentPredicate>
+	std::future<SearchResult> FindTopDocumentsAsync(
+		std::string raw_query,
+		DocumentPredicate document_predicate,
+		SearchLimits limits) const;
+
+	std::future<SearchResult> FindTopDocumentsAsync(
+		std::string raw_query,
+		DocumentStatus status,
+		SearchLimits limits) const;
+
+	std::future<SearchResult> FindTopDocumentsAsync(
+		std::string raw_query,
+		SearchLimits limits) const;
+
+	// Пакетный поиск: запросы разбираются заранее и группируются по словам,
+	// список вхождений каждого слова читается один раз для всех запросов пакета.
+	// Элемент i совпадает с FindTopDocuments(raw_queries[i], ...)
+	template <typename DocumentPredicate>
+	std::vector<std::vector<Document>> FindTopDocumentsBatch(
+		const std::vector<std::string>& raw_queries,
+		DocumentPredicate document_predicate) const;
+
+	std::vector<std::vector<Document>> FindTopDocumentsBatch(
+		const std::vector<std::string>& raw_queries,
+		DocumentStatus status) const;
+
+	std::vector<std::vector<Document>> FindTopDocumentsBatch(
+		const std::vector<std::string>& raw_queries) const;
+
 	int GetDocumentCount() const;
 
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
@@ -96,11 +295,32 @@ public:
 		int document_id
 	) const;
 
-	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+	using MatchResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+	// Запрос разбирается один раз для всех документов
+	std::vector<MatchResult> MatchDocuments(
+		const std::string_view raw_query,
+		const std::vector<int>& document_ids) const;
+
+	std::vector<MatchResult> MatchDocuments(
+		const std::execution::sequenced_policy& policy,
+		const std::string_view raw_query,
+		const std::vector<int>& document_ids) const;
+
+	std::vector<MatchResult> MatchDocuments(
+		const std::execution::parallel_policy& policy,
+		const std::string_view raw_query,
+		const std::vector<int>& document_ids) const;
+
+	// Представление действительно до следующего изменения набора документов
+	WordFrequencies GetWordFrequencies(int document_id) const;
 
 	void RemoveDocument(int document_id);
 	void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
 	void RemoveDocument(const std::execution::parallel_policy& policy, int document_id);
+	// Удаляет документы пакетом: список id, прямой индекс и слоты сжимаются
+	// один раз на пакет, а не после каждого документа. Отсутствующие id пропускаются
+	void RemoveDocuments(const std::vector<int>& document_ids);
 
 	std::vector<int>::iterator begin();
 	std::vector<int>::const_iterator begin() const;
@@ -110,18 +330,92 @@ public:
 
 private:
 	struct DocumentData {
-		int rating;
-		DocumentStatus status;
-		std::map<std::string_view, double> words;
+		uint32_t slot;
+		ForwardIndex::Range words;
+	};
+
+	struct IndexMemory {
+		MemoryCounter document_texts;
+		MemoryCounter inverted_index;
+		MemoryCounter forward_index;
+		MemoryCounter documents;
+		// Тексты и временные списки остаются в куче
+		std::unique_ptr<IndexArena> arena;
+
+		explicit IndexMemory(IndexAllocation allocation) {
+			if (allocation == IndexAllocation::HUGE_PAGES) {
+				arena = std::make_unique<IndexArena>();
+				inverted_index.SetArena(arena.get());
+				forward_index.SetArena(arena.get());
+				documents.SetArena(arena.get());
+			}
+		}
 	};
-	const std::set<std::string> stop_words_;
-	std::set<std::string, std::less<>> documents_words_;
 
-	std::map<std::string_view, std::map<int, double>, std::less<>> word_to_document_freqs_;
-	std::map<int, DocumentData> documents_;
+	template <typename Key, typename Value>
+	using CountedMap = std::map<Key, Value, std::less<>, CountingAllocator<std::pair<const Key, Value>>>;
+	using DocumentTexts = std::set<CountedString, std::less<>, CountingAllocator<CountedString>>;
+	using DocumentMap = CountedMap<int, DocumentData>;
+
+	template <typename Score>
+	using Accumulator = typename Traits::template Accumulator<Score>;
+
+	template <typename Score>
+	struct ScoreTag {
+		using type = Score;
+	};
+
+	static_assert(std::is_void_v<typename Traits::Score> || std::is_same_v<typename Traits::Score, float>
+		|| std::is_same_v<typename Traits::Score, double>, "Traits::Score must be void, float or double");
+
+	const typename Traits::StopWords stop_words_;
+	const typename Traits::Tokenizer tokenizer_{};
+	std::unique_ptr<IndexMemory> memory_;
+	DocumentTexts documents_words_{ DocumentTexts::allocator_type(&memory_->document_texts) };
+
+	CountedMap<std::string_view, PostingList> word_to_document_freqs_{
+		CountedMap<std::string_view, PostingList>::allocator_type(&memory_->inverted_index) };
+	TermDictionary term_dictionary_{ &memory_->inverted_index };
+	DocumentMap documents_{ typename DocumentMap::allocator_type(&memory_->documents) };
+	// Документы нумеруются внутренними слотами в порядке добавления.
+	// Слоты удалённых документов отбрасываются, когда их не меньше половины
+	DocumentAttributes attributes_{ &memory_->documents };
+	ForwardIndex forward_index_{ &memory_->forward_index };
 	std::vector<int> documents_id_;
+	size_t memory_budget_ = 0;
+	bool index_has_garbage_ = false;
+	std::vector<std::shared_ptr<const void>> external_storage_;
+	ScoreType score_type_ = std::is_same_v<typename Traits::Score, float> ? ScoreType::FLOAT : ScoreType::DOUBLE;
+	bool validate_scores_ = false;
+	bool adaptive_execution_ = true;
+	IndexLayout index_layout_ = IndexLayout::DOCUMENT_ORDERED;
+	size_t max_term_expansions_ = 64;
+	mutable QueryCounters query_counters_;
+
+	void CheckNewDocumentId(int document_id) const;
+
+	static std::vector<WordFrequency> ComputeWordFrequencies(const std::vector<std::string_view>& words);
+
+	// Средняя длина записи разрыва на вхождение по всем спискам, см. CountGapBits
+	double ComputeAverageGapBits() const;
+
+	// Слот i получает документ слота old_slots[i], остальные слоты
+	// и их вхождения отбрасываются
+	void RenumberSlots(const std::vector<uint32_t>& old_slots);
+	// Отбрасывает слоты удалённых документов, сохраняя порядок остальных
+	void CompactSlots();
 
-	inline bool IsStopWord(const std::string_view word) const;
+	size_t EstimateDocumentMemory(size_t text_size, const std::vector<WordFrequency>& word_frequencies) const;
+
+	void ReserveDocumentMemory(size_t text_size, const std::vector<WordFrequency>& word_frequencies);
+
+	void IndexDocument(
+		int document_id,
+		const std::vector<WordFrequency>& word_frequencies,
+		DocumentStatus status,
+		int rating);
+
+	bool IsStopWord(const std::string_view word) const;
 
 	static bool IsValidWord(const std::string_view word);
 
@@ -135,62 +429,196 @@ private:
 		bool is_stop;
 	};
 
-	inline QueryWord ParseQueryWord(const std::string_view text) const;
+	QueryWord ParseQueryWord(const std::string_view text) const;
 
+	// Раскрытый шаблон: объединение списков вхождений выбранных слов
+	struct TermExpansion {
+		std::string_view pattern;
+		std::pmr::vector<const PostingList*> sources;
+		PostingList postings;
+	};
+
+	// Временные данные запроса размещаются в арене (см. QueryArena).
+	// Шаблоны входят в plus_words и minus_words наравне со словами
 	struct Query {
-		std::vector<std::string_view> plus_words;
-		std::vector<std::string_view> minus_words;
+		std::pmr::vector<std::string_view> plus_words;
+		std::pmr::vector<std::string_view> minus_words;
+		std::pmr::vector<TermExpansion> expansions;
+	};
+
+	// Без merge_patterns шаблоны раскрываются только в список слов:
+	// для MatchDocument объединённые списки вхождений не нужны
+	Query ParseQuery(const std::string_view text, std::pmr::memory_resource* resource, bool merge_patterns = true) const;
+
+	void ExpandWordPattern(std::string_view pattern, Query& query, bool merge_postings) const;
+	const TermExpansion* FindExpansion(const Query& query, std::string_view pattern) const;
+
+	// Список вхождений слова или раскрытого шаблона запроса, nullptr — если пуст
+	const PostingList* FindPostings(const Query& query, std::string_view word) const;
+
+	bool ShouldParallelize(size_t work) const;
+	size_t EstimateQueryWork(const Query& query) const;
+
+	// Декларативный фильтр, вычисленный по всем слотам до подсчёта
+	// релевантности: бит s установлен, если слот s проходит фильтр
+	struct SlotFilter {
+		const uint64_t* bits = nullptr;
+		size_t passed_count = 0;
+
+		bool Passes(uint32_t slot) const {
+			return (bits[slot / 64] >> (slot % 64)) & 1;
+		}
 	};
 
-	Query ParseQuery(const std::string_view text) const;
+	// Вычисление фильтра по слоту во столько раз дешевле обработки вхождения
+	static const size_t SLOT_FILTER_COST_RATIO = 8;
+
+	size_t GetSlotFilterWordCount() const {
+		return (attributes_.size() + 63) / 64;
+	}
+	// bits — буфер из GetSlotFilterWordCount() слов, на который ссылается результат
+	SlotFilter EvaluateSlotFilter(const DocumentFilter& filter, uint64_t* bits) const;
+	// Фильтр по всем слотам окупается, если запрос обходит достаточно вхождений
+	bool ShouldEvaluateSlotFilter(const Query& query) const;
+
+	// Упорядочивает плюс-слова по возрастанию длины списков вхождений
+	void SortByDocumentFreq(Query& query) const;
+
+	MatchResult MatchQuery(const Query& query, int document_id) const;
+	MatchResult MatchQuery(const Query& query, const DocumentData& document) const;
+
+	void RemoveDocumentFromIndex(typename DocumentMap::iterator document);
+	// Убирает документ, уже удалённый из списков вхождений, из словаря,
+	// атрибутов и прямого индекса; id и сжатие остаются вызывающему
+	void EraseDocument(typename DocumentMap::iterator document);
+	// Прямой индекс и слоты сжимаются, когда мусора в них не меньше половины
+	void CompactAfterRemoval();
+
+	double ComputeWordInverseDocumentFreq(const PostingList& postings) const;
+
+	static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
 
-	double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+	// Вызывает search с ScoreTag типа накопителя: заданного в Traits
+	// или выбранного через SetScoreType
+	template <typename Search>
+	decltype(auto) WithScoreType(Search search) const;
+
+	template <typename ExecutionPolicy>
+	static void SelectTopDocuments(ExecutionPolicy&& policy, std::pmr::vector<Document>& documents);
+
+	void ValidateTopDocuments(
+		const std::pmr::vector<Document>& top_documents,
+		std::pmr::vector<Document> reference_documents) const;
 
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(
+	std::vector<Document> FindDocumentsPage(
+		const std::string_view raw_query,
+		DocumentPredicate document_predicate,
+		size_t skip,
+		size_t count,
+		const Document* after) const;
+
+	template <typename Score, typename DocumentPredicate>
+	std::vector<Document> SelectDocuments(
 		const Query& query,
-		DocumentPredicate document_predicate) const;
+		DocumentPredicate document_predicate,
+		size_t skip,
+		size_t count,
+		const Document* after,
+		QueryTracer& tracer,
+		std::pmr::memory_resource* resource) const;
+
+	// Возвращает false, если подсчёт релевантности прерван по limits
+	template <typename Score, typename DocumentPredicate, typename DocumentConsumer>
+	bool ForEachMatchedDocument(
+		const Query& query,
+		DocumentPredicate document_predicate,
+		QueryTracer& tracer,
+		DocumentConsumer consume_document,
+		const SearchLimits* limits = nullptr) const;
+
+	template <typename Score, typename DocumentPredicate>
+	std::pmr::vector<Document> FindTopDocumentsByImpact(
+		const Query& query,
+		DocumentPredicate document_predicate,
+		QueryTracer& tracer,
+		std::pmr::memory_resource* resource) const;
+
+	template <typename Score, typename DocumentPredicate>
+	std::pmr::vector<Document> FindAllDocuments(
+		const Query& query,
+		DocumentPredicate document_predicate,
+		QueryTracer& tracer,
+		std::pmr::memory_resource* resource) const;
 
-	template<typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(
+	template <typename Score, typename DocumentPredicate>
+	void FindAllDocumentsBatch(
+		const std::vector<Query>& queries,
+		DocumentPredicate document_predicate,
+		std::vector<std::vector<Document>>& results) const;
+
+	template <typename Score, typename DocumentPredicate>
+	std::pmr::vector<Document> FindAllDocumentsAdaptive(
 		std::execution::parallel_policy policy,
 		const Query& query,
-		DocumentPredicate document_predicate) const;
+		DocumentPredicate document_predicate,
+		QueryTracer& tracer,
+		std::pmr::memory_resource* resource) const;
+
+	template <typename Score, typename DocumentPredicate>
+	std::pmr::vector<Document> FindAllDocuments(
+		std::execution::parallel_policy policy,
+		const Query& query,
+		DocumentPredicate document_predicate,
+		QueryTracer& tracer,
+		std::pmr::memory_resource* resource) const;
 };
 
+template <typename Traits>
 template<typename StringContainer>
-inline SearchServer::SearchServer(const StringContainer& stop_words)
-	: stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+inline BasicSearchServer<Traits>::BasicSearchServer(const StringContainer& stop_words, IndexAllocation allocation)
+	: stop_words_([&stop_words] {
+		const auto words = MakeUniqueNonEmptyStrings(stop_words);
+		return typename Traits::StopWords(words.begin(), words.end());
+		}())
+	, memory_(std::make_unique<IndexMemory>(allocation))
 {
 	if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
 		throw std::invalid_argument("Some of stop words are invalid");
 	}
+	// Калибровка порогов параллельного выполнения при запуске
+	ExecutionCostModel::Instance();
 }
 
+template <typename Traits>
 template<typename DocumentPredicate>
-inline std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+inline std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
 {
-	const auto query = ParseQuery(raw_query);
+	const QueryArena::Scope arena;
+	QueryTracer tracer(query_counters_);
+	const auto query = ParseQuery(raw_query, arena.Resource());
+	tracer.EndPhase(QueryPhase::PARSE);
 
-	auto matched_documents = FindAllDocuments(query, document_predicate);
-
-	std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < MIN_RELEVANCE_DIFFERENCE) {
-			return lhs.rating > rhs.rating;
-		}
-		else {
-			return lhs.relevance > rhs.relevance;
-		}
+	auto matched_documents = WithScoreType([&](auto score) {
+		using Score = typename decltype(score)::type;
+		return (index_layout_ == IndexLayout::IMPACT_ORDERED)
+			? FindTopDocumentsByImpact<Score>(query, document_predicate, tracer, arena.Resource())
+			: FindAllDocuments<Score>(query, document_predicate, tracer, arena.Resource());
 		});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
+	tracer.SetDocumentsFound(matched_documents.size());
+	SelectTopDocuments(std::execution::seq, matched_documents);
+	tracer.EndPhase(QueryPhase::SORT);
 
-	return matched_documents;
+	if (validate_scores_ && score_type_ != ScoreType::DOUBLE) {
+		QueryTracer reference_tracer;
+		ValidateTopDocuments(matched_documents, FindAllDocuments<double>(query, document_predicate, reference_tracer, arena.Resource()));
+	}
+	return { matched_documents.begin(), matched_documents.end() };
 }
 
+template <typename Traits>
 template<typename DocumentPredicate>
-inline std::vector<Document> SearchServer::FindTopDocuments(
+inline std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::execution::sequenced_policy& policy,
 	const std::string_view raw_query,
 	DocumentPredicate document_predicate) const
@@ -198,108 +626,870 @@ inline std::vector<Document> SearchServer::FindTopDocuments(
 	return FindTopDocuments(raw_query, document_predicate);
 }
 
+template <typename Traits>
 template<typename DocumentPredicate>
-inline std::vector<Document> SearchServer::FindTopDocuments(
+inline std::vector<Document> BasicSearchServer<Traits>::FindTopDocuments(
 	const std::execution::parallel_policy& policy,
 	const std::string_view raw_query,
 	DocumentPredicate document_predicate) const
 {
-	const auto query = ParseQuery(raw_query);
+	const QueryArena::Scope arena;
+	QueryTracer tracer(query_counters_);
+	const auto query = ParseQuery(raw_query, arena.Resource());
+	tracer.EndPhase(QueryPhase::PARSE);
 
-	auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+	auto matched_documents = WithScoreType([&](auto score) {
+		return FindAllDocumentsAdaptive<typename decltype(score)::type>(policy, query, document_predicate, tracer, arena.Resource());
+		});
+	tracer.SetDocumentsFound(matched_documents.size());
+	if (ShouldParallelize(SortWork(matched_documents.size()))) {
+		SelectTopDocuments(policy, matched_documents);
+	}
+	else {
+		SelectTopDocuments(std::execution::seq, matched_documents);
+	}
+	tracer.EndPhase(QueryPhase::SORT);
 
-	std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < MIN_RELEVANCE_DIFFERENCE) {
-			return lhs.rating > rhs.rating;
-		}
-		else {
-			return lhs.relevance > rhs.relevance;
+	if (validate_scores_ && score_type_ != ScoreType::DOUBLE) {
+		QueryTracer reference_tracer;
+		ValidateTopDocuments(matched_documents, FindAllDocumentsAdaptive<double>(policy, query, document_predicate, reference_tracer, arena.Resource()));
+	}
+	return { matched_documents.begin(), matched_documents.end() };
+}
+
+template <typename Traits>
+template<typename DocumentPredicate>
+inline std::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsPage(
+	const std::string_view raw_query,
+	size_t page_number,
+	size_t page_size,
+	DocumentPredicate document_predicate) const
+{
+	if (page_size == 0) {
+		throw std::invalid_argument("Page size must be positive");
+	}
+	if (page_number > (SIZE_MAX - page_size) / page_size) {
+		throw std::invalid_argument("Page number is too large");
+	}
+	return FindDocumentsPage(raw_query, document_predicate, page_number * page_size, page_size, nullptr);
+}
+
+template <typename Traits>
+template<typename DocumentPredicate>
+inline std::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsAfter(
+	const std::string_view raw_query,
+	const Document& last_document,
+	size_t page_size,
+	DocumentPredicate document_predicate) const
+{
+	if (page_size == 0) {
+		throw std::invalid_argument("Page size must be positive");
+	}
+	return FindDocumentsPage(raw_query, document_predicate, 0, page_size, &last_document);
+}
+
+template <typename Traits>
+template<typename DocumentPredicate>
+inline SearchResult BasicSearchServer<Traits>::FindTopDocumentsWithin(
+	const std::string_view raw_query,
+	DocumentPredicate document_predicate,
+	const SearchLimits& limits) const
+{
+	const QueryArena::Scope arena;
+	QueryTracer tracer(query_counters_);
+	auto query = ParseQuery(raw_query, arena.Resource());
+	SortByDocumentFreq(query);
+	tracer.EndPhase(QueryPhase::PARSE);
+
+	std::pmr::vector<Document> matched_documents(arena.Resource());
+	const auto consume_document = [&matched_documents](const Document& document) {
+		matched_documents.push_back(document);
+	};
+	const bool is_complete = WithScoreType([&](auto score) {
+		return ForEachMatchedDocument<typename decltype(score)::type>(query, document_predicate, tracer, consume_document, &limits);
+		});
+	tracer.SetDocumentsFound(matched_documents.size());
+	SelectTopDocuments(std::execution::seq, matched_documents);
+	tracer.EndPhase(QueryPhase::SORT);
+
+	return { { matched_documents.begin(), matched_documents.end() }, is_complete };
+}
+
+template <typename Traits>
+template<typename DocumentPredicate>
+inline std::future<SearchResult> BasicSearchServer<Traits>::FindTopDocumentsAsync(
+	std::string raw_query,
+	DocumentPredicate document_predicate,
+	SearchLimits limits) const
+{
+	return std::async(std::launch::async,
+		[this, raw_query = std::move(raw_query), document_predicate, limits = std::move(limits)]() {
+			return FindTopDocumentsWithin(raw_query, document_predicate, limits);
+		});
+}
+
+template <typename Traits>
+template<typename DocumentPredicate>
+inline std::vector<std::vector<Document>> BasicSearchServer<Traits>::FindTopDocumentsBatch(
+	const std::vector<std::string>& raw_queries,
+	DocumentPredicate document_predicate) const
+{
+	// Разобранные запросы нужны до конца пакета, поэтому не в арене потока
+	std::pmr::monotonic_buffer_resource resource;
+	std::vector<Query> queries;
+	queries.reserve(raw_queries.size());
+	for (const std::string& raw_query : raw_queries) {
+		queries.push_back(ParseQuery(raw_query, &resource));
+	}
+
+	std::vector<std::vector<Document>> results(queries.size());
+	WithScoreType([&](auto score) {
+		FindAllDocumentsBatch<typename decltype(score)::type>(queries, document_predicate, results);
+		});
+
+	if (validate_scores_ && score_type_ != ScoreType::DOUBLE) {
+		for (size_t i = 0; i < queries.size(); ++i) {
+			const QueryArena::Scope arena;
+			QueryTracer reference_tracer;
+			const std::pmr::vector<Document> top_documents(results[i].begin(), results[i].end(), arena.Resource());
+			ValidateTopDocuments(top_documents, FindAllDocuments<double>(queries[i], document_predicate, reference_tracer, arena.Resource()));
 		}
+	}
+	return results;
+}
+
+template <typename Traits>
+template<typename DocumentPredicate>
+inline std::vector<Document> BasicSearchServer<Traits>::FindDocumentsPage(
+	const std::string_view raw_query,
+	DocumentPredicate document_predicate,
+	size_t skip,
+	size_t count,
+	const Document* after) const
+{
+	const QueryArena::Scope arena;
+	QueryTracer tracer(query_counters_);
+	const auto query = ParseQuery(raw_query, arena.Resource());
+	tracer.EndPhase(QueryPhase::PARSE);
+
+	return WithScoreType([&](auto score) {
+		return SelectDocuments<typename decltype(score)::type>(query, document_predicate, skip, count, after, tracer, arena.Resource());
+		});
+}
+
+// Ограниченный отбор: куча из skip + count лучших документов, на вершине
+// худший из них. Документы не позже after в порядке выдачи пропускаются
+template <typename Traits>
+template<typename Score, typename DocumentPredicate>
+inline std::vector<Document> BasicSearchServer<Traits>::SelectDocuments(
+	const Query& query,
+	DocumentPredicate document_predicate,
+	size_t skip,
+	size_t count,
+	const Document* after,
+	QueryTracer& tracer,
+	std::pmr::memory_resource* resource) const
+{
+	const size_t limit = skip + count;
+	std::pmr::vector<Document> selected(resource);
+	size_t found_count = 0;
+	ForEachMatchedDocument<Score>(query, document_predicate, tracer,
+		[after, limit, &selected, &found_count](const Document& document) {
+			if (after != nullptr && !IsMoreRelevant(*after, document)) {
+				return;
+			}
+			++found_count;
+			if (selected.size() < limit) {
+				selected.push_back(document);
+				std::push_heap(selected.begin(), selected.end(), IsMoreRelevant);
+			}
+			else if (IsMoreRelevant(document, selected.front())) {
+				std::pop_heap(selected.begin(), selected.end(), IsMoreRelevant);
+				selected.back() = document;
+				std::push_heap(selected.begin(), selected.end(), IsMoreRelevant);
+			}
 		});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+	tracer.SetDocumentsFound(found_count);
+
+	std::sort_heap(selected.begin(), selected.end(), IsMoreRelevant);
+	tracer.EndPhase(QueryPhase::SORT);
+	return { selected.begin() + std::min(skip, selected.size()), selected.end() };
+}
+
+template <typename Traits>
+template<typename ExecutionPolicy>
+inline void BasicSearchServer<Traits>::SelectTopDocuments(ExecutionPolicy&& policy, std::pmr::vector<Document>& documents)
+{
+	std::sort(policy, documents.begin(), documents.end(), IsMoreRelevant);
+	if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+		documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+	}
+}
+
+// Оценка по вкладам (score-at-a-time): блоки вхождений всех слов обходятся
+// в порядке убывания вклада tf * idf. Частичная сумма документа — нижняя
+// граница его релевантности, а частичная сумма плюс остаток — сумма
+// следующих вкладов всех слов — верхняя. Обход останавливается, когда
+// верхние границы всех документов вне топа ниже K-й нижней границы
+// с запасом, при котором сравнение IsMoreRelevant решается релевантностью.
+// Релевантность претендентов затем пересчитывается в порядке слов
+// запроса, поэтому совпадает с FindAllDocuments
+template <typename Traits>
+template<typename Score, typename DocumentPredicate>
+inline std::pmr::vector<Document> BasicSearchServer<Traits>::FindTopDocumentsByImpact(
+	const Query& query,
+	DocumentPredicate document_predicate,
+	QueryTracer& tracer,
+	std::pmr::memory_resource* resource) const
+{
+	const size_t BLOCK_SIZE = 256;
+	const double MARGIN = 2 * MIN_RELEVANCE_DIFFERENCE;
+	const size_t top_count = MAX_RESULT_DOCUMENT_COUNT;
+
+	struct TermCursor {
+		const PostingList* postings;
+		Score inverse_document_freq;
+		size_t position;
+
+		double NextImpact() const {
+			return position < postings->size()
+				? postings->ImpactTermFreqs()[position] * static_cast<double>(inverse_document_freq)
+				: 0.0;
+		}
+	};
+	std::pmr::vector<TermCursor> terms(resource);
+	for (const std::string_view word : query.plus_words) {
+		if (const PostingList* postings = FindPostings(query, word)) {
+			terms.push_back({ postings, static_cast<Score>(ComputeWordInverseDocumentFreq(*postings)), 0 });
+		}
+	}
+	std::pmr::vector<const PostingList*> minus_postings(resource);
+	for (const std::string_view word : query.minus_words) {
+		if (const PostingList* postings = FindPostings(query, word)) {
+			minus_postings.push_back(postings);
+		}
+	}
+
+	auto& accumulator = Accumulator<Score>::ForThread();
+	accumulator.Reset(attributes_.size());
+
+	// Декларативный фильтр вычисляется по всем слотам, если запрос
+	// может обойти достаточно вхождений
+	constexpr bool is_filter = std::is_same_v<std::decay_t<DocumentPredicate>, DocumentFilter>;
+	SlotFilter slot_filter;
+	if constexpr (is_filter) {
+		if (ShouldEvaluateSlotFilter(query)) {
+			thread_local std::vector<uint64_t> slot_bits;
+			slot_bits.resize(GetSlotFilterWordCount());
+			slot_filter = EvaluateSlotFilter(document_predicate, slot_bits.data());
+		}
+	}
+	const auto passes_filter = [&](uint32_t slot) {
+		if constexpr (is_filter) {
+			if (slot_filter.bits != nullptr) {
+				return slot_filter.Passes(slot);
+			}
+		}
+		return !attributes_.IsFree(slot)
+			&& document_predicate(attributes_.GetId(slot), attributes_.GetStatus(slot), attributes_.GetRating(slot));
+	};
+
+	// Минус-слова и фильтр проверяются один раз, при первой встрече документа
+	const auto exclude_ineligible = [&](size_t first_new) {
+		const std::vector<uint32_t>& candidates = accumulator.Candidates();
+		for (size_t i = first_new; i < candidates.size(); ++i) {
+			const uint32_t slot = candidates[i];
+			const bool has_minus_word = std::any_of(minus_postings.begin(), minus_postings.end(),
+				[slot](const PostingList* postings) {
+					return postings->Contains(slot);
+				});
+			if (has_minus_word) {
+				tracer.AddExcludedByMinusWords(accumulator.Exclude(&slot, 1));
+			}
+			else if (!passes_filter(slot)) {
+				tracer.AddExcludedByPredicate(accumulator.Exclude(&slot, 1));
+			}
+		}
+	};
+
+	// Оставляет в contenders документы, которые ещё могут войти в топ,
+	// и сообщает, можно ли остановиться при остатке remaining. Непросмотренные
+	// документы набирают не больше remaining, просмотренные — не больше S + remaining
+	std::pmr::vector<uint32_t> contenders(resource);
+	const auto settle = [&](double remaining, size_t remaining_postings, bool exhausted) {
+		contenders.clear();
+		for (const uint32_t slot : accumulator.Candidates()) {
+			if (!accumulator.IsExcluded(slot)) {
+				contenders.push_back(slot);
+			}
+		}
+		if (contenders.size() < top_count) {
+			return exhausted;
+		}
+		std::nth_element(contenders.begin(), contenders.begin() + (top_count - 1), contenders.end(),
+			[&accumulator](uint32_t lhs, uint32_t rhs) {
+				return accumulator.GetScore(lhs) > accumulator.GetScore(rhs);
+			});
+		const double threshold = static_cast<double>(accumulator.GetScore(contenders[top_count - 1]));
+		// Запас покрывает и погрешность частичных сумм в типе Score
+		const double margin = MARGIN + 4.0 * terms.size() * std::numeric_limits<Score>::epsilon() * std::abs(threshold);
+		if (!exhausted && remaining >= threshold - margin) {
+			return false;
+		}
+		const auto end = std::partition(contenders.begin(), contenders.end(), [&](uint32_t slot) {
+			return static_cast<double>(accumulator.GetScore(slot)) + remaining >= threshold - margin;
+			});
+		// Претенденты пересчитываются поиском по каждому слову,
+		// останавливаться стоит, только если это дешевле дочитать списки
+		if (!exhausted && static_cast<size_t>(end - contenders.begin()) * terms.size() > remaining_postings) {
+			return false;
+		}
+		contenders.erase(end, contenders.end());
+		return true;
+	};
+
+	size_t scanned_since_check = 0;
+	while (true) {
+		TermCursor* next_term = nullptr;
+		double next_impact = 0.0;
+		double remaining = 0.0;
+		size_t remaining_postings = 0;
+		for (TermCursor& term : terms) {
+			const double impact = term.NextImpact();
+			remaining += impact;
+			remaining_postings += term.postings->size() - term.position;
+			if (term.position < term.postings->size() && (next_term == nullptr || impact > next_impact)) {
+				next_term = &term;
+				next_impact = impact;
+			}
+		}
+		const bool exhausted = remaining_postings == 0;
+		// Проверка стоит O(кандидатов), поэтому выполняется не чаще,
+		// чем просмотрено вхождений столько же
+		if (exhausted || scanned_since_check >= std::max(BLOCK_SIZE, accumulator.Candidates().size())) {
+			scanned_since_check = 0;
+			if (settle(remaining, remaining_postings, exhausted) || exhausted) {
+				break;
+			}
+		}
+
+		const PostingList& postings = *next_term->postings;
+		const size_t count = std::min(BLOCK_SIZE, postings.size() - next_term->position);
+		const uint32_t* slots = postings.ImpactSlots() + next_term->position;
+		AccumulateScores(slots, postings.ImpactTermFreqs() + next_term->position, count, next_term->inverse_document_freq, accumulator.Scores());
+		const size_t first_new = accumulator.Candidates().size();
+		accumulator.Touch(slots, count);
+		exclude_ineligible(first_new);
+		next_term->position += count;
+		scanned_since_check += count;
+		tracer.AddPostingsScanned(count);
 	}
+	tracer.AddDocumentsScored(accumulator.Candidates().size());
+	tracer.EndPhase(QueryPhase::SCORE);
 
+	std::pmr::vector<Document> matched_documents(resource);
+	matched_documents.reserve(contenders.size());
+	// Пересчёт тем же ядром, что и в FindAllDocuments, даёт побитово ту же сумму
+	const uint32_t single_slot = 0;
+	for (const uint32_t slot : contenders) {
+		Score relevance = 0;
+		for (const TermCursor& term : terms) {
+			const size_t position = term.postings->LowerBound(slot);
+			if (position < term.postings->size() && term.postings->Slots()[position] == slot) {
+				AccumulateScores(&single_slot, term.postings->TermFreqs() + position, 1, term.inverse_document_freq, &relevance);
+			}
+		}
+		matched_documents.push_back({ attributes_.GetId(slot), static_cast<double>(relevance), attributes_.GetRating(slot) });
+	}
+	tracer.EndPhase(QueryPhase::FILTER);
 	return matched_documents;
 }
 
-template<typename DocumentPredicate>
-inline std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const
+template <typename Traits>
+template<typename Score, typename DocumentPredicate>
+inline std::pmr::vector<Document> BasicSearchServer<Traits>::FindAllDocuments(
+	const Query& query,
+	DocumentPredicate document_predicate,
+	QueryTracer& tracer,
+	std::pmr::memory_resource* resource) const
 {
-	std::map<int, double> document_to_relevance;
+	std::pmr::vector<Document> matched_documents(resource);
+	ForEachMatchedDocument<Score>(query, document_predicate, tracer,
+		[&matched_documents](const Document& document) {
+			matched_documents.push_back(document);
+		});
+	return matched_documents;
+}
+
+template <typename Traits>
+template<typename Score, typename DocumentPredicate, typename DocumentConsumer>
+inline bool BasicSearchServer<Traits>::ForEachMatchedDocument(
+	const Query& query,
+	DocumentPredicate document_predicate,
+	QueryTracer& tracer,
+	DocumentConsumer consume_document,
+	const SearchLimits* limits) const
+{
+	const size_t FILTER_BLOCK_SIZE = 1024;
+
+	auto& accumulator = Accumulator<Score>::ForThread();
+	accumulator.Reset(attributes_.size());
+
+	// Декларативный фильтр запроса с длинными списками вхождений вычисляется
+	// по всем слотам до подсчёта релевантности. Если его проходит не больше
+	// половины документов, вхождения остальных пропускаются, иначе фильтр
+	// проверяется битом слота. Для коротких списков фильтр вычисляется
+	// после подсчёта только по кандидатам
+	constexpr bool is_filter = std::is_same_v<std::decay_t<DocumentPredicate>, DocumentFilter>;
+	SlotFilter slot_filter;
+	bool skip_filtered = false;
+	if constexpr (is_filter) {
+		if (ShouldEvaluateSlotFilter(query)) {
+			thread_local std::vector<uint64_t> slot_bits;
+			slot_bits.resize(GetSlotFilterWordCount());
+			slot_filter = EvaluateSlotFilter(document_predicate, slot_bits.data());
+			skip_filtered = slot_filter.passed_count * 2 <= attributes_.size();
+		}
+	}
+	// Отобранные вхождения собираются блоками на стеке; порядок сохраняется,
+	// поэтому релевантность складывается так же, как без пропуска
+	const auto accumulate = [&](const uint32_t* slots, const double* term_freqs, size_t count, Score inverse_document_freq) {
+		if (!skip_filtered) {
+			AccumulateScores(slots, term_freqs, count, inverse_document_freq, accumulator.Scores());
+			accumulator.Touch(slots, count);
+			return;
+		}
+		uint32_t passed_slots[FILTER_BLOCK_SIZE];
+		double passed_term_freqs[FILTER_BLOCK_SIZE];
+		for (size_t first = 0; first < count; first += FILTER_BLOCK_SIZE) {
+			const size_t last = std::min(count, first + FILTER_BLOCK_SIZE);
+			size_t passed = 0;
+			for (size_t i = first; i < last; ++i) {
+				passed_slots[passed] = slots[i];
+				passed_term_freqs[passed] = term_freqs[i];
+				passed += slot_filter.Passes(slots[i]);
+			}
+			AccumulateScores(passed_slots, passed_term_freqs, passed, inverse_document_freq, accumulator.Scores());
+			accumulator.Touch(passed_slots, passed);
+		}
+	};
+
+	// С ограничениями списки вхождений обходятся порциями между проверками
+	bool is_complete = true;
 	for (const std::string_view word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+		const PostingList* word_postings = FindPostings(query, word);
+		if (word_postings == nullptr) {
 			continue;
 		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string{ word });
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-			const auto& document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating)) {
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
+		const PostingList& postings = *word_postings;
+		const Score inverse_document_freq = static_cast<Score>(ComputeWordInverseDocumentFreq(postings));
+		const size_t chunk_size = limits != nullptr ? SearchLimits::CHECK_INTERVAL : postings.size();
+		for (size_t first = 0; first < postings.size(); first += chunk_size) {
+			if (limits != nullptr && limits->IsExhausted()) {
+				is_complete = false;
+				break;
 			}
+			const size_t count = std::min(chunk_size, postings.size() - first);
+			accumulate(postings.Slots() + first, postings.TermFreqs() + first, count, inverse_document_freq);
+			tracer.AddPostingsScanned(count);
+		}
+		if (!is_complete) {
+			break;
 		}
 	}
+	tracer.AddDocumentsScored(accumulator.Candidates().size());
+	tracer.EndPhase(QueryPhase::SCORE);
 
 	for (const std::string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+		if (const PostingList* postings = FindPostings(query, word)) {
+			tracer.AddExcludedByMinusWords(accumulator.Exclude(postings->Slots(), postings->size()));
+		}
+	}
+	tracer.EndPhase(QueryPhase::MINUS_WORDS);
+
+	// Без фильтра по слотам декларативный фильтр вычисляется пакетно
+	// по всем кандидатам сразу, произвольный предикат — по одному документу
+	const std::vector<uint32_t>& candidates = accumulator.Candidates();
+	thread_local std::vector<uint64_t> filter_bits;
+	if constexpr (is_filter) {
+		if (slot_filter.bits == nullptr) {
+			filter_bits.resize((candidates.size() + 63) / 64);
+			attributes_.Evaluate(document_predicate, candidates.data(), candidates.size(), filter_bits.data());
+		}
+	}
+
+	size_t excluded_by_predicate = 0;
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (i + PREFETCH_DISTANCE < candidates.size()) {
+			accumulator.Prefetch(candidates[i + PREFETCH_DISTANCE]);
+			attributes_.Prefetch(candidates[i + PREFETCH_DISTANCE]);
+		}
+		const uint32_t slot = candidates[i];
+		if (accumulator.IsExcluded(slot)) {
 			continue;
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-			document_to_relevance.erase(document_id);
+		bool matches;
+		if constexpr (is_filter) {
+			matches = slot_filter.bits != nullptr
+				? slot_filter.Passes(slot)
+				: (filter_bits[i / 64] >> (i % 64)) & 1;
+		}
+		else {
+			matches = !attributes_.IsFree(slot)
+				&& document_predicate(attributes_.GetId(slot), attributes_.GetStatus(slot), attributes_.GetRating(slot));
+		}
+		if (matches) {
+			consume_document(Document{ attributes_.GetId(slot), static_cast<double>(accumulator.GetScore(slot)), attributes_.GetRating(slot) });
+		}
+		else {
+			++excluded_by_predicate;
 		}
 	}
+	tracer.AddExcludedByPredicate(excluded_by_predicate);
+	tracer.EndPhase(QueryPhase::FILTER);
+	return is_complete;
+}
 
-	std::vector<Document> matched_documents;
+// Пакет обходится блоками слотов. В каждом блоке вхождения слова читаются
+// один раз и добавляются в накопители всех запросов с этим словом; накопители
+// занимают block_size слотов на запрос и остаются в кэше. Слова обходятся
+// по возрастанию, как plus_words каждого запроса, поэтому релевантность
+// складывается в том же порядке и тем же ядром, что в ForEachMatchedDocument.
+// Для каждого запроса хранятся только лучшие документы, как в SelectDocuments
+template <typename Traits>
+template<typename Score, typename DocumentPredicate>
+inline void BasicSearchServer<Traits>::FindAllDocumentsBatch(
+	const std::vector<Query>& queries,
+	DocumentPredicate document_predicate,
+	std::vector<std::vector<Document>>& results) const
+{
+	const size_t CACHE_BUDGET = 1 << 20;
+	const uint8_t NONE = 0;
+	const uint8_t CANDIDATE = 1;
+	const uint8_t EXCLUDED = 2;
+	const size_t top_count = MAX_RESULT_DOCUMENT_COUNT;
+
+	struct BatchTerm {
+		const PostingList* postings = nullptr;
+		Score inverse_document_freq = 0;
+		std::vector<uint32_t> plus_queries;
+		std::vector<uint32_t> minus_queries;
+	};
 
-	for (const auto [document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+	// Раскрытие шаблона зависит только от индекса, поэтому берётся
+	// из первого запроса с этим шаблоном
+	std::map<std::string_view, BatchTerm> terms_by_word;
+	for (uint32_t q = 0; q < queries.size(); ++q) {
+		for (const std::string_view word : queries[q].plus_words) {
+			terms_by_word[word].plus_queries.push_back(q);
+		}
+		for (const std::string_view word : queries[q].minus_words) {
+			terms_by_word[word].minus_queries.push_back(q);
+		}
+	}
+
+	std::vector<BatchTerm*> terms;
+	size_t work = 0;
+	for (auto& [word, term] : terms_by_word) {
+		const uint32_t first_query = term.plus_queries.empty() ? term.minus_queries.front() : term.plus_queries.front();
+		term.postings = FindPostings(queries[first_query], word);
+		if (term.postings == nullptr) {
+			continue;
+		}
+		if (!term.plus_queries.empty()) {
+			term.inverse_document_freq = static_cast<Score>(ComputeWordInverseDocumentFreq(*term.postings));
+		}
+		work += term.postings->size() * (term.plus_queries.size() + term.minus_queries.size());
+		terms.push_back(&term);
+	}
+
+	const size_t slot_count = attributes_.size();
+	const size_t block_size = std::clamp<size_t>(
+		CACHE_BUDGET / ((sizeof(Score) + sizeof(uint8_t)) * std::max<size_t>(queries.size(), 1)),
+		64, 1 << 16);
+
+	// Куча из top_count лучших документов запроса, на вершине худший
+	struct TopDocuments {
+		std::vector<Document> heap;
+
+		void Add(const Document& document, size_t limit) {
+			if (heap.size() < limit) {
+				heap.push_back(document);
+				std::push_heap(heap.begin(), heap.end(), IsMoreRelevant);
+			}
+			else if (IsMoreRelevant(document, heap.front())) {
+				std::pop_heap(heap.begin(), heap.end(), IsMoreRelevant);
+				heap.back() = document;
+				std::push_heap(heap.begin(), heap.end(), IsMoreRelevant);
+			}
+		}
+	};
+
+	const auto score_range = [&](size_t first_slot, size_t last_slot, std::vector<TopDocuments>& top_documents) {
+		std::vector<size_t> positions(terms.size());
+		std::vector<size_t> block_ends(terms.size());
+		for (size_t i = 0; i < terms.size(); ++i) {
+			positions[i] = terms[i]->postings->LowerBound(static_cast<uint32_t>(first_slot));
+		}
+		// Строка накопителя выдаётся запросу при первом вхождении в блоке
+		std::vector<Score> scores;
+		std::vector<uint8_t> marks;
+		std::vector<std::vector<uint32_t>> row_candidates;
+		std::vector<uint32_t> row_queries;
+		std::vector<int32_t> query_rows(queries.size(), -1);
+		const auto row_for_query = [&](uint32_t q) {
+			if (query_rows[q] < 0) {
+				query_rows[q] = static_cast<int32_t>(row_queries.size());
+				row_queries.push_back(q);
+				if (row_candidates.size() < row_queries.size()) {
+					row_candidates.emplace_back();
+					scores.resize(row_candidates.size() * block_size, 0);
+					marks.resize(row_candidates.size() * block_size, NONE);
+				}
+			}
+			return static_cast<size_t>(query_rows[q]);
+		};
+		std::vector<uint32_t> offsets;
+
+		for (size_t block_first = first_slot; block_first < last_slot; block_first += block_size) {
+			const size_t block_last = std::min(last_slot, block_first + block_size);
+
+			for (size_t i = 0; i < terms.size(); ++i) {
+				const BatchTerm& term = *terms[i];
+				const uint32_t* slots = term.postings->Slots();
+				block_ends[i] = std::lower_bound(slots + positions[i], slots + term.postings->size(), static_cast<uint32_t>(block_last)) - slots;
+				const size_t count = block_ends[i] - positions[i];
+				if (count == 0 || term.plus_queries.empty()) {
+					continue;
+				}
+				offsets.resize(count);
+				for (size_t k = 0; k < count; ++k) {
+					offsets[k] = slots[positions[i] + k] - static_cast<uint32_t>(block_first);
+				}
+				const double* term_freqs = term.postings->TermFreqs() + positions[i];
+				for (const uint32_t q : term.plus_queries) {
+					const size_t row = row_for_query(q);
+					AccumulateScores(offsets.data(), term_freqs, count, term.inverse_document_freq, scores.data() + row * block_size);
+					uint8_t* row_marks = marks.data() + row * block_size;
+					for (const uint32_t offset : offsets) {
+						if (row_marks[offset] == NONE) {
+							row_marks[offset] = CANDIDATE;
+							row_candidates[row].push_back(offset);
+						}
+					}
+				}
+			}
+
+			for (size_t i = 0; i < terms.size(); ++i) {
+				const BatchTerm& term = *terms[i];
+				const uint32_t* slots = term.postings->Slots();
+				for (const uint32_t q : term.minus_queries) {
+					if (query_rows[q] < 0) {
+						continue;
+					}
+					uint8_t* row_marks = marks.data() + query_rows[q] * block_size;
+					for (size_t k = positions[i]; k < block_ends[i]; ++k) {
+						uint8_t& mark = row_marks[slots[k] - block_first];
+						if (mark != NONE) {
+							mark = EXCLUDED;
+						}
+					}
+				}
+				positions[i] = block_ends[i];
+			}
+
+			for (size_t row = 0; row < row_queries.size(); ++row) {
+				const uint32_t q = row_queries[row];
+				Score* row_scores = scores.data() + row * block_size;
+				uint8_t* row_marks = marks.data() + row * block_size;
+				for (const uint32_t offset : row_candidates[row]) {
+					const uint32_t slot = static_cast<uint32_t>(block_first + offset);
+					if (row_marks[offset] == CANDIDATE && !attributes_.IsFree(slot)
+						&& document_predicate(attributes_.GetId(slot), attributes_.GetStatus(slot), attributes_.GetRating(slot))) {
+						top_documents[q].Add({ attributes_.GetId(slot), static_cast<double>(row_scores[offset]), attributes_.GetRating(slot) }, top_count);
+					}
+					row_scores[offset] = 0;
+					row_marks[offset] = NONE;
+				}
+				row_candidates[row].clear();
+				query_rows[q] = -1;
+			}
+			row_queries.clear();
+		}
+	};
+
+	// Диапазоны слотов независимы, параллельно обрабатываются целыми блоками
+	const size_t block_count = (slot_count + block_size - 1) / block_size;
+	const size_t task_count = ShouldParallelize(work)
+		? std::min(ExecutionCostModel::Instance().ChooseTaskCount(work), std::max<size_t>(block_count, 1))
+		: 1;
+	std::vector<std::vector<TopDocuments>> task_top_documents(task_count, std::vector<TopDocuments>(queries.size()));
+	if (task_count == 1) {
+		score_range(0, slot_count, task_top_documents[0]);
+	}
+	else {
+		std::vector<size_t> tasks(task_count);
+		std::iota(tasks.begin(), tasks.end(), 0);
+		std::for_each(std::execution::par, tasks.begin(), tasks.end(), [&](size_t task) {
+			const size_t first_block = block_count * task / task_count;
+			const size_t last_block = block_count * (task + 1) / task_count;
+			score_range(first_block * block_size, std::min(slot_count, last_block * block_size), task_top_documents[task]);
+			});
+	}
+
+	std::pmr::vector<Document> matched_documents;
+	for (size_t q = 0; q < queries.size(); ++q) {
+		matched_documents.clear();
+		for (const auto& top_documents : task_top_documents) {
+			matched_documents.insert(matched_documents.end(), top_documents[q].heap.begin(), top_documents[q].heap.end());
+		}
+		SelectTopDocuments(std::execution::seq, matched_documents);
+		results[q].assign(matched_documents.begin(), matched_documents.end());
 	}
-	return matched_documents;
 }
 
-template<typename DocumentPredicate>
-inline std::vector<Document> SearchServer::FindAllDocuments(
+template <typename Traits>
+template<typename Score, typename DocumentPredicate>
+inline std::pmr::vector<Document> BasicSearchServer<Traits>::FindAllDocumentsAdaptive(
 	std::execution::parallel_policy policy,
 	const Query& query,
-	DocumentPredicate document_predicate) const
+	DocumentPredicate document_predicate,
+	QueryTracer& tracer,
+	std::pmr::memory_resource* resource) const
 {
-	ConcurrentMap<int, double> document_to_relevance(CONCURENT_MAP_BUCKET_COUNT);
+	if (ShouldParallelize(EstimateQueryWork(query))) {
+		return FindAllDocuments<Score>(policy, query, document_predicate, tracer, resource);
+	}
+	return FindAllDocuments<Score>(query, document_predicate, tracer, resource);
+}
+
+// Декларативный фильтр вычисляется по всем слотам до подсчёта релевантности,
+// и вхождения не прошедших его документов не попадают в общую таблицу.
+// Произвольный предикат применяется после подсчёта, один раз на документ.
+// Списки вхождений делятся на задачи по объёму, а не по словам,
+// чтобы и запрос из одного частого слова занимал все потоки
+template <typename Traits>
+template<typename Score, typename DocumentPredicate>
+inline std::pmr::vector<Document> BasicSearchServer<Traits>::FindAllDocuments(
+	std::execution::parallel_policy policy,
+	const Query& query,
+	DocumentPredicate document_predicate,
+	QueryTracer& tracer,
+	std::pmr::memory_resource* resource) const
+{
+	ConcurrentMap<uint32_t, Score> document_to_relevance(CONCURRENT_MAP_BUCKET_COUNT);
+
+	constexpr bool is_filter = std::is_same_v<std::decay_t<DocumentPredicate>, DocumentFilter>;
+	std::pmr::vector<uint64_t> slot_bits(resource);
+	SlotFilter slot_filter;
+	if constexpr (is_filter) {
+		slot_bits.resize(GetSlotFilterWordCount());
+		slot_filter = EvaluateSlotFilter(document_predicate, slot_bits.data());
+	}
+
+	struct ScoreTask {
+		const PostingList* postings;
+		Score inverse_document_freq;
+		size_t first;
+		size_t last;
+	};
+	const size_t work = EstimateQueryWork(query);
+	const size_t task_size = std::max<size_t>(work / ExecutionCostModel::Instance().ChooseTaskCount(work), 1);
+	std::pmr::vector<ScoreTask> tasks(resource);
+	for (const std::string_view word : query.plus_words) {
+		const PostingList* postings = FindPostings(query, word);
+		if (postings == nullptr) {
+			continue;
+		}
+		const Score inverse_document_freq = static_cast<Score>(ComputeWordInverseDocumentFreq(*postings));
+		for (size_t first = 0; first < postings->size(); first += task_size) {
+			tasks.push_back({ postings, inverse_document_freq, first, std::min(first + task_size, postings->size()) });
+		}
+	}
 
 	for_each(policy,
-		query.plus_words.begin(), query.plus_words.end(),
-		[this, &document_to_relevance, &document_predicate](const std::string_view word) {
-			auto it = word_to_document_freqs_.find(word);
-			if (it == word_to_document_freqs_.end()) {
-				return;
-			}
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto [document_id, term_freq] : it->second) {
-				const auto& document_data = documents_.at(document_id);
-				if (document_predicate(document_id, document_data.status, document_data.rating)) {
-					document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+		tasks.begin(), tasks.end(),
+		[&document_to_relevance, &slot_filter](const ScoreTask& task) {
+			const uint32_t* slots = task.postings->Slots();
+			const double* term_freqs = task.postings->TermFreqs();
+			for (size_t i = task.first; i < task.last; ++i) {
+				if constexpr (is_filter) {
+					if (!slot_filter.Passes(slots[i])) {
+						continue;
+					}
 				}
+				document_to_relevance[slots[i]].ref_to_value += static_cast<Score>(term_freqs[i]) * task.inverse_document_freq;
 			}
 		});
+	size_t scored_count = 0;
+	if constexpr (QueryTracer::ENABLED) {
+		for (const std::string_view word : query.plus_words) {
+			const PostingList* postings = FindPostings(query, word);
+			tracer.AddPostingsScanned(postings == nullptr ? 0 : postings->size());
+		}
+		scored_count = document_to_relevance.Size();
+		tracer.AddDocumentsScored(scored_count);
+	}
+	tracer.EndPhase(QueryPhase::SCORE);
 
 	for (const std::string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
+		const PostingList* postings = FindPostings(query, word);
+		if (postings == nullptr) {
 			continue;
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-			document_to_relevance.Erase(document_id);
+		for (size_t i = 0; i < postings->size(); ++i) {
+			document_to_relevance.Erase(postings->Slots()[i]);
 		}
 	}
+	const size_t candidate_count = document_to_relevance.Size();
+	tracer.AddExcludedByMinusWords(scored_count - candidate_count);
+	tracer.EndPhase(QueryPhase::MINUS_WORDS);
 
-	std::vector<Document> matched_documents(document_to_relevance.Size());
+	std::pmr::vector<Document> matched_documents(candidate_count, resource);
 	std::atomic_size_t index = 0;
 	for_each(policy,
 		document_to_relevance.begin(), document_to_relevance.end(),
-		[this, &index, &matched_documents](const auto& documents) {
-			for (auto [document_id, relevance] : documents) {
-				int raiting = documents_.at(document_id).rating;
-				matched_documents[index++] = { document_id, relevance, raiting };
+		[this, &index, &matched_documents, &document_predicate](const auto& documents) {
+			for (auto [slot, relevance] : documents) {
+				const int document_id = attributes_.GetId(slot);
+				const int rating = attributes_.GetRating(slot);
+				bool matches;
+				if constexpr (is_filter) {
+					// Свободные слоты фильтр по слотам не пропускает
+					matches = true;
+				}
+				else {
+					matches = document_id != DocumentAttributes::FREE_SLOT_ID && document_predicate(document_id, attributes_.GetStatus(slot), rating);
+				}
+				if (matches) {
+					matched_documents[index++] = { document_id, static_cast<double>(relevance), rating };
+				}
 			}
 		});
+	matched_documents.resize(index);
+	tracer.AddExcludedByPredicate(candidate_count - matched_documents.size());
+	tracer.EndPhase(QueryPhase::FILTER);
 
 	return matched_documents;
-}
\ No newline at end of file
+}
+
+template <typename Traits>
+template <typename Search>
+inline decltype(auto) BasicSearchServer<Traits>::WithScoreType(Search search) const
+{
+	if constexpr (std::is_void_v<typename Traits::Score>) {
+		if (score_type_ == ScoreType::FLOAT) {
+			return search(ScoreTag<float>{});
+		}
+		return search(ScoreTag<double>{});
+	}
+	else {
+		return search(ScoreTag<typename Traits::Score>{});
+	}
+}
+
+extern template class BasicSearchServer<DefaultSearchServerTraits>;
+extern template class BasicSearchServer<CompactSearchServerTraits>;
+
+using SearchServer = BasicSearchServer<DefaultSearchServerTraits>;
+using CompactSearchServer = BasicSearchServer<CompactSearchServerTraits>;
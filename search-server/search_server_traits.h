@@ -0,0 +1,40 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <functional>
+#include <cstddef>
+
+#include "score_accumulator.h"
+#include "string_processing.h"
+
+// Параметры SearchServer, известные при компиляции. Набор с фиксированным
+// типом накопителя и размером выдачи убирает из горячих циклов ветвления
+// по настройкам. Для нового набора нужна явная инстанциация в search_server.cpp.
+// Id документов — int: они хранятся 32-битными столбцами (DocumentAttributes)
+// и общие для всех наборов вместе с Document и DocumentFilter
+struct DefaultSearchServerTraits {
+	// Тип накопителя релевантности, void — выбирается через SetScoreType
+	using Score = void;
+
+	// Накопитель релевантности одного потока, интерфейс как у ScoreAccumulator
+	template <typename AccumulatorScore>
+	using Accumulator = ScoreAccumulator<AccumulatorScore>;
+
+	// Разбивает текст на слова, слова ссылаются на текст
+	using Tokenizer = WhitespaceTokenizer;
+
+	// Множество стоп-слов с поиском count(std::string_view)
+	using StopWords = std::set<std::string, std::less<>>;
+
+	static constexpr size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+	static constexpr double MIN_RELEVANCE_DIFFERENCE = 1e-6;
+	static constexpr size_t CONCURRENT_MAP_BUCKET_COUNT = 100;
+};
+
+// Накопитель float и топ-10
+struct CompactSearchServerTraits : DefaultSearchServerTraits {
+	using Score = float;
+
+	static constexpr size_t MAX_RESULT_DOCUMENT_COUNT = 10;
+};
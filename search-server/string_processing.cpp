@@ -2,34 +2,55 @@
 
 using namespace std;
 
-vector<string_view> SplitIntoWords(const string_view& text) {
-	vector<string_view> words;
-	words.reserve(500);
+namespace {
 
-	size_t pos0 = 0;
-	size_t pos1 = 0;
-	for (const char c : text) {
-		if (c != ' ') {
-			++pos1;
-		}
-		else {
-			if (pos1 != 0) {
-				words.push_back(text.substr(pos0, pos1));
-				pos0 += ++pos1;
-				pos1 = 0;
+	template <typename Words>
+	void AppendWords(const string_view& text, Words& words) {
+		size_t pos0 = 0;
+		size_t pos1 = 0;
+		for (const char c : text) {
+			if (c != ' ') {
+				++pos1;
+			}
+			else {
+				if (pos1 != 0) {
+					words.push_back(text.substr(pos0, pos1));
+					pos0 += ++pos1;
+					pos1 = 0;
+				}
 			}
 		}
-	}
-	if (pos1 != 0) {
-		words.push_back(text.substr(pos0, pos1));
+		if (pos1 != 0) {
+			words.push_back(text.substr(pos0, pos1));
+		}
 	}
 
+}
+
+vector<string_view> SplitIntoWords(const string_view& text) {
+	vector<string_view> words;
+	words.reserve(500);
+	AppendWords(text, words);
+	return words;
+}
+
+std::pmr::vector<std::string_view> SplitIntoWords(const std::string_view& text, std::pmr::memory_resource* resource) {
+	pmr::vector<string_view> words(resource);
+	AppendWords(text, words);
 	return words;
 }
 
-std::set<std::string> MakeUniqueNonEmptyStrings(const std::vector<std::string_view>& strings)
+std::vector<std::string_view> WhitespaceTokenizer::operator()(std::string_view text) const {
+	return SplitIntoWords(text);
+}
+
+std::pmr::vector<std::string_view> WhitespaceTokenizer::operator()(std::string_view text, std::pmr::memory_resource* resource) const {
+	return SplitIntoWords(text, resource);
+}
+
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const std::vector<std::string_view>& strings)
 {
-	std::set<std::string> non_empty_strings;
+	std::set<std::string, std::less<>> non_empty_strings;
 	for (const std::string_view& str : strings) {
 		if (!str.empty()) {
 			non_empty_strings.insert(string{ str });
@@ -4,12 +4,21 @@
 #include <string>
 #include <string_view>
 #include <set>
+#include <functional>
+#include <memory_resource>
 
 std::vector<std::string_view> SplitIntoWords(const std::string_view& text);
+std::pmr::vector<std::string_view> SplitIntoWords(const std::string_view& text, std::pmr::memory_resource* resource);
+
+// Токенизатор SearchServer по умолчанию: слова разделены пробелами
+struct WhitespaceTokenizer {
+    std::vector<std::string_view> operator()(std::string_view text) const;
+    std::pmr::vector<std::string_view> operator()(std::string_view text, std::pmr::memory_resource* resource) const;
+};
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string& str : strings) {
         if (!str.empty()) {
             non_empty_strings.insert(str);
@@ -18,4 +27,4 @@ std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings)
     return non_empty_strings;
 }
 
-std::set<std::string> MakeUniqueNonEmptyStrings(const std::vector<std::string_view>& strings);
\ No newline at end of file
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const std::vector<std::string_view>& strings);
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+	template <typename String>
+	void AppendLength(String& out, size_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<char>(value));
+	}
+
+	size_t ReadLength(const CountedString& in, size_t& position) {
+		size_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			const auto byte = static_cast<unsigned char>(in[position++]);
+			value |= static_cast<size_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+	}
+
+	// Запись слова в блоке: длина общего с предыдущим словом префикса и остаток
+	template <typename String>
+	void AppendEntry(String& out, size_t shared, std::string_view term) {
+		AppendLength(out, shared);
+		AppendLength(out, term.size() - shared);
+		out.append(term.data() + shared, term.size() - shared);
+	}
+
+	size_t SharedPrefixSize(std::string_view lhs, std::string_view rhs) {
+		return mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()).first - lhs.begin();
+	}
+
+	size_t LengthSize(size_t value) {
+		size_t size = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			++size;
+		}
+		return size;
+	}
+
+}
+
+bool IsWordPattern(std::string_view word)
+{
+	return word.find(WORD_PATTERN_WILDCARD) != string_view::npos;
+}
+
+// Жадное сопоставление с возвратом к последней звёздочке, O(|pattern| * |word|)
+bool MatchesWordPattern(std::string_view pattern, std::string_view word)
+{
+	size_t p = 0;
+	size_t w = 0;
+	size_t star = string_view::npos;
+	size_t star_word = 0;
+	while (w < word.size()) {
+		if (p < pattern.size() && pattern[p] == WORD_PATTERN_WILDCARD) {
+			star = p++;
+			star_word = w;
+		}
+		else if (p < pattern.size() && pattern[p] == word[w]) {
+			++p;
+			++w;
+		}
+		else if (star != string_view::npos) {
+			p = star + 1;
+			w = ++star_word;
+		}
+		else {
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == WORD_PATTERN_WILDCARD) {
+		++p;
+	}
+	return p == pattern.size();
+}
+
+TermDictionary::TermDictionary(MemoryCounter* counter)
+	: counter_(counter)
+	, blocks_(CountingAllocator<Block>(counter))
+{
+}
+
+void TermDictionary::Insert(std::string_view term, const PostingList* postings)
+{
+	if (blocks_.empty()) {
+		const string first(term);
+		blocks_.push_back(Encode(&first, &postings, 1));
+		++size_;
+		return;
+	}
+
+	// Слово вписывается в сжатый блок на месте: перекодируются только
+	// оно само и следующее слово, общий префикс которого меняется
+	const size_t b = FindBlock(term);
+	Block& block = blocks_[b];
+	string previous;
+	string current;
+	size_t position = 0;
+	size_t entry_start = 0;
+	size_t index = 0;
+	for (; index < block.postings.size(); ++index) {
+		entry_start = position;
+		DecodeNext(block.terms, position, current);
+		if (string_view(current) >= term) {
+			break;
+		}
+		previous = current;
+	}
+	if (index == block.postings.size()) {
+		entry_start = position;
+	}
+	else if (current == term) {
+		block.postings[index] = postings;
+		return;
+	}
+
+	string entries;
+	AppendEntry(entries, SharedPrefixSize(previous, term), term);
+	if (index < block.postings.size()) {
+		AppendEntry(entries, SharedPrefixSize(term, current), current);
+	}
+	block.terms.replace(entry_start, position - entry_start, entries);
+	block.postings.insert(block.postings.begin() + index, postings);
+	++size_;
+
+	if (block.postings.size() > MAX_BLOCK_SIZE) {
+		SplitBlock(b);
+	}
+}
+
+void TermDictionary::Erase(std::string_view term)
+{
+	if (blocks_.empty()) {
+		return;
+	}
+	const size_t b = FindBlock(term);
+	Block& block = blocks_[b];
+	string previous;
+	string current;
+	size_t position = 0;
+	size_t entry_start = 0;
+	size_t index = 0;
+	for (; index < block.postings.size(); ++index) {
+		entry_start = position;
+		DecodeNext(block.terms, position, current);
+		if (string_view(current) >= term) {
+			break;
+		}
+		previous = current;
+	}
+	if (index == block.postings.size() || current != term) {
+		return;
+	}
+	--size_;
+	if (block.postings.size() == 1) {
+		blocks_.erase(blocks_.begin() + b);
+		return;
+	}
+
+	// Следующее слово перекодируется относительно предыдущего
+	string entries;
+	if (index + 1 < block.postings.size()) {
+		DecodeNext(block.terms, position, current);
+		AppendEntry(entries, SharedPrefixSize(previous, current), current);
+	}
+	block.terms.replace(entry_start, position - entry_start, entries);
+	block.postings.erase(block.postings.begin() + index);
+}
+
+size_t TermDictionary::size() const
+{
+	return size_;
+}
+
+// Слово записывается не длиннее, чем целиком, а общий префикс следующего
+// за ним слова только растёт, поэтому блок прирастает не больше чем на запись
+// слова. При разделении вторая половина копируется в новый блок
+size_t TermDictionary::AppendCost(std::string_view term) const
+{
+	const size_t entry_size = 2 * LengthSize(term.size()) + term.size();
+	if (blocks_.empty()) {
+		return entry_size + sizeof(const PostingList*) + ::AppendCost(blocks_, 1);
+	}
+	const Block& block = blocks_[FindBlock(term)];
+	size_t cost = ::AppendCost(block.terms, entry_size) + ::AppendCost(block.postings, 1);
+	if (block.postings.size() >= MAX_BLOCK_SIZE) {
+		cost += ::AppendCost(blocks_, 1) + block.terms.size() + entry_size + block.postings.size() * sizeof(const PostingList*);
+	}
+	return cost;
+}
+
+size_t TermDictionary::FindBlock(std::string_view term) const
+{
+	const auto it = upper_bound(blocks_.begin(), blocks_.end(), term, [](string_view lhs, const Block& rhs) {
+		return lhs < FirstTerm(rhs);
+		});
+	return it == blocks_.begin() ? 0 : (it - blocks_.begin()) - 1;
+}
+
+// Первое слово блока записано без общего префикса
+std::string_view TermDictionary::FirstTerm(const Block& block)
+{
+	size_t position = 1;
+	const size_t size = ReadLength(block.terms, position);
+	return string_view(block.terms.data() + position, size);
+}
+
+void TermDictionary::DecodeNext(const CountedString& terms, size_t& position, std::string& term)
+{
+	const size_t shared = ReadLength(terms, position);
+	const size_t suffix = ReadLength(terms, position);
+	term.resize(shared);
+	term.append(terms.data() + position, suffix);
+	position += suffix;
+}
+
+// Вторая половина блока переносится в новый блок, её первое слово
+// записывается целиком
+void TermDictionary::SplitBlock(size_t b)
+{
+	Block& block = blocks_[b];
+	const size_t half = block.postings.size() / 2;
+	string current;
+	size_t position = 0;
+	size_t half_start = 0;
+	for (size_t i = 0; i <= half; ++i) {
+		half_start = position;
+		DecodeNext(block.terms, position, current);
+	}
+
+	Block second{ CountedString(CountingAllocator<char>(counter_)), CountedVector<const PostingList*>(CountingAllocator<const PostingList*>(counter_)) };
+	second.terms.reserve(2 * LengthSize(current.size()) + current.size() + block.terms.size() - position);
+	AppendEntry(second.terms, 0, current);
+	second.terms.append(block.terms, position, string::npos);
+	second.postings.assign(block.postings.begin() + half, block.postings.end());
+	block.terms.resize(half_start);
+	block.postings.resize(half);
+	blocks_.insert(blocks_.begin() + b + 1, move(second));
+}
+
+TermDictionary::Block TermDictionary::Encode(const std::string* terms, const PostingList* const* postings, size_t count) const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const size_t shared = i == 0 ? 0 : SharedPrefixSize(terms[i - 1], terms[i]);
+		bytes += LengthSize(shared) + LengthSize(terms[i].size() - shared) + terms[i].size() - shared;
+	}
+
+	Block block{ CountedString(CountingAllocator<char>(counter_)), CountedVector<const PostingList*>(CountingAllocator<const PostingList*>(counter_)) };
+	block.terms.reserve(bytes);
+	for (size_t i = 0; i < count; ++i) {
+		AppendEntry(block.terms, i == 0 ? 0 : SharedPrefixSize(terms[i - 1], terms[i]), terms[i]);
+	}
+	block.postings.assign(postings, postings + count);
+	return block;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_accounting.h"
+#include "posting_list.h"
+
+// Подстановочный символ шаблона слова запроса: любая, в том числе пустая,
+// последовательность символов. hold* — префикс, h*ld — шаблон. Шаблон
+// начинается с буквы: по его префиксу ищется диапазон слов словаря
+const char WORD_PATTERN_WILDCARD = '*';
+
+bool IsWordPattern(std::string_view word);
+bool MatchesWordPattern(std::string_view pattern, std::string_view word);
+
+// Словарь индекса: отсортированные слова со списками вхождений.
+// Слова хранятся блоками с префиксным сжатием — каждое записано как длина
+// общего с предыдущим префикса и остаток, — поэтому перебор слов с общим
+// префиксом читает компактную непрерывную память, а не узлы дерева
+class TermDictionary {
+public:
+	explicit TermDictionary(MemoryCounter* counter);
+
+	// Списки вхождений не должны перемещаться, пока слово в словаре
+	void Insert(std::string_view term, const PostingList* postings);
+	void Erase(std::string_view term);
+
+	size_t size() const;
+
+	// Верхняя оценка дополнительной памяти под новое слово
+	size_t AppendCost(std::string_view term) const;
+
+	// Вызывает visit(слово, списки вхождений) для слов, подходящих под шаблон,
+	// по возрастанию слов. Слово действительно только во время вызова.
+	// Шаблон с ведущей звёздочкой отклоняется: он обошёл бы весь словарь
+	template <typename Visitor>
+	void ForEachMatch(std::string_view pattern, Visitor visit) const;
+
+private:
+	static const size_t MAX_BLOCK_SIZE = 64;
+
+	struct Block {
+		CountedString terms;
+		CountedVector<const PostingList*> postings;
+	};
+
+	MemoryCounter* counter_;
+	CountedVector<Block> blocks_;
+	size_t size_ = 0;
+
+	// Последний блок, первое слово которого не больше term
+	size_t FindBlock(std::string_view term) const;
+	static std::string_view FirstTerm(const Block& block);
+
+	// Читает очередное слово блока в term с позиции position
+	static void DecodeNext(const CountedString& terms, size_t& position, std::string& term);
+	void SplitBlock(size_t b);
+	Block Encode(const std::string* terms, const PostingList* const* postings, size_t count) const;
+};
+
+template <typename Visitor>
+void TermDictionary::ForEachMatch(std::string_view pattern, Visitor visit) const
+{
+	const std::string_view prefix = pattern.substr(0, pattern.find(WORD_PATTERN_WILDCARD));
+	if (prefix.empty()) {
+		throw std::invalid_argument("Word pattern must not start with a wildcard");
+	}
+	std::string term;
+	for (size_t b = FindBlock(prefix); b < blocks_.size(); ++b) {
+		const Block& block = blocks_[b];
+		size_t position = 0;
+		for (size_t i = 0; i < block.postings.size(); ++i) {
+			DecodeNext(block.terms, position, term);
+			if (std::string_view(term) < prefix) {
+				continue;
+			}
+			if (std::string_view(term).substr(0, prefix.size()) != prefix) {
+				return;
+			}
+			if (MatchesWordPattern(pattern, term)) {
+				visit(std::string_view(term), block.postings[i]);
+			}
+		}
+	}
+}
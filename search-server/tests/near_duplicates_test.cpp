@@ -0,0 +1,126 @@
+#include "../near_duplicates.h"
+#include "../search_server.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+	size_t failures = 0;
+
+	void Check(bool condition, const string& message) {
+		if (!condition) {
+			cerr << message << endl;
+			++failures;
+		}
+	}
+
+	string MakeText(int first_word, int word_count) {
+		string text;
+		for (int w = 0; w < word_count; ++w) {
+			text += "word"s + to_string(first_word + w) + " "s;
+		}
+		return text;
+	}
+
+	// Большая группа одинаковых документов сводится к одному
+	void TestLargeIdenticalGroup() {
+		SearchServer search_server(""s);
+		for (int id = 0; id < 100; ++id) {
+			search_server.AddDocument(id, MakeText(0, 20), DocumentStatus::ACTUAL, { 1 });
+		}
+		const vector<NearDuplicate> duplicates = FindNearDuplicates(search_server);
+		Check(duplicates.size() == 99, "Identical group: "s + to_string(duplicates.size()) + " duplicates instead of 99"s);
+		for (size_t i = 0; i < duplicates.size(); ++i) {
+			Check(duplicates[i].document_id == static_cast<int>(i) + 1 && duplicates[i].original_id == 0 && duplicates[i].similarity == 1.0,
+				"Identical group: wrong duplicate of document "s + to_string(duplicates[i].document_id));
+		}
+		RemoveNearDuplicates(search_server);
+		Check(search_server.GetDocumentCount() == 1, "Identical group: "s + to_string(search_server.GetDocumentCount()) + " documents left"s);
+	}
+
+	// Группы вперемешку с разными документами: остаётся первый документ каждой группы
+	void TestInterleavedGroups() {
+		SearchServer search_server(""s);
+		const int group_count = 5;
+		const int group_size = 40;
+		int id = 0;
+		for (int copy = 0; copy < group_size; ++copy) {
+			for (int group = 0; group < group_count; ++group) {
+				search_server.AddDocument(id++, MakeText(group * 100, 30), DocumentStatus::ACTUAL, { 1 });
+			}
+			search_server.AddDocument(id++, MakeText(1000 + copy * 50, 30), DocumentStatus::ACTUAL, { 1 });
+		}
+		const vector<NearDuplicate> duplicates = FindNearDuplicates(search_server);
+		Check(duplicates.size() == static_cast<size_t>(group_count * (group_size - 1)),
+			"Interleaved groups: "s + to_string(duplicates.size()) + " duplicates"s);
+		for (const NearDuplicate& duplicate : duplicates) {
+			Check(duplicate.original_id < group_count && duplicate.document_id % (group_count + 1) == duplicate.original_id,
+				"Interleaved groups: document "s + to_string(duplicate.document_id) + " matched "s + to_string(duplicate.original_id));
+		}
+	}
+
+	// Похожий, но не одинаковый документ: одно слово из двадцати заменено
+	void TestSimilarDocument() {
+		SearchServer search_server(""s);
+		search_server.AddDocument(1, MakeText(0, 20), DocumentStatus::ACTUAL, { 1 });
+		search_server.AddDocument(2, MakeText(1, 20), DocumentStatus::ACTUAL, { 1 });
+		search_server.AddDocument(3, MakeText(500, 20), DocumentStatus::ACTUAL, { 1 });
+		NearDuplicateOptions options;
+		options.min_similarity = 0.9;
+		const vector<NearDuplicate> duplicates = FindNearDuplicates(search_server, options);
+		Check(duplicates.size() == 1 && duplicates[0].document_id == 2 && duplicates[0].original_id == 1,
+			"Similar document was not found"s);
+	}
+
+	// Пакетное удаление оставляет индекс таким же, как удаление по одному
+	void TestBatchRemoval() {
+		SearchServer batch(""s);
+		SearchServer single(""s);
+		for (int id = 0; id < 3000; ++id) {
+			const string text = MakeText(id % 37, 5 + id % 11);
+			batch.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 7 });
+			single.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 7 });
+		}
+		vector<int> removed;
+		for (int id = 0; id < 3000; id += 1 + id % 3) {
+			removed.push_back(id);
+		}
+		removed.push_back(100000);
+		batch.RemoveDocuments(removed);
+		for (const int id : removed) {
+			if (id < 3000) {
+				single.RemoveDocument(id);
+			}
+		}
+		Check(vector<int>(batch.begin(), batch.end()) == vector<int>(single.begin(), single.end()), "Batch removal: document ids differ"s);
+		for (int word = 0; word < 60; word += 3) {
+			const string query = "word"s + to_string(word) + " word"s + to_string(word + 1);
+			const vector<Document> lhs = batch.FindTopDocuments(query);
+			const vector<Document> rhs = single.FindTopDocuments(query);
+			bool same = lhs.size() == rhs.size();
+			for (size_t i = 0; same && i < lhs.size(); ++i) {
+				same = lhs[i].id == rhs[i].id && lhs[i].relevance == rhs[i].relevance && lhs[i].rating == rhs[i].rating;
+			}
+			Check(same, "Batch removal: results differ for "s + query);
+		}
+	}
+
+}
+
+int main() {
+	TestLargeIdenticalGroup();
+	TestInterleavedGroups();
+	TestSimilarDocument();
+	TestBatchRemoval();
+	if (failures > 0) {
+		cerr << failures << " checks failed"s << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "near_duplicates_test: OK"s << endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+#include "../search_server.h"
+#include "../document_filter.h"
+#include "../query_arena.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Глобальный operator new считает выделения, пока включён счётчик
+namespace {
+
+	bool counting = false;
+	size_t allocation_count = 0;
+	size_t allocated_bytes = 0;
+
+	void* Allocate(size_t size) {
+		if (counting) {
+			++allocation_count;
+			allocated_bytes += size;
+		}
+		if (void* pointer = malloc(size == 0 ? 1 : size)) {
+			return pointer;
+		}
+		throw bad_alloc();
+	}
+
+}
+
+void* operator new(size_t size) {
+	return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+	return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	free(pointer);
+}
+
+namespace {
+
+	const vector<string> QUERIES = {
+		"curly cat"s,
+		"funny pet -collar"s,
+		"cat dog bird fish"s,
+		"ca* -dog"s,
+		"nasty rat -not"s,
+	};
+
+	void AddDocuments(SearchServer& search_server) {
+		const vector<string> words = { "curly"s, "cat"s, "funny"s, "pet"s, "dog"s, "collar"s, "bird"s,
+			"fish"s, "nasty"s, "rat"s, "not"s, "very"s, "big"s, "small"s, "cap"s, "car"s };
+		for (int id = 0; id < 5000; ++id) {
+			string text;
+			for (size_t w = 0; w < 8; ++w) {
+				text += words[(id * 7 + w * w * 13 + w) % words.size()] + " "s;
+			}
+			search_server.AddDocument(id, text, static_cast<DocumentStatus>(id % 4), { id % 10, 1 });
+		}
+	}
+
+	// Выполняет все запросы и возвращает число выделений сверх памяти под результаты
+	template <typename DocumentPredicate>
+	size_t CountQueryAllocations(const SearchServer& search_server, DocumentPredicate document_predicate) {
+		size_t extra = 0;
+		for (const string& query : QUERIES) {
+			allocation_count = 0;
+			allocated_bytes = 0;
+			counting = true;
+			const vector<Document> documents = search_server.FindTopDocuments(query, document_predicate);
+			counting = false;
+			// Единственное допустимое выделение — буфер возвращаемого вектора
+			const size_t result_allocations = documents.empty() ? 0 : 1;
+			if (allocation_count != result_allocations
+				|| allocated_bytes != documents.size() * sizeof(Document)) {
+				cerr << "Query \""s << query << "\": "s << allocation_count << " allocations, "s
+					<< allocated_bytes << " bytes for "s << documents.size() << " documents"s << endl;
+				++extra;
+			}
+		}
+		return extra;
+	}
+
+	template <typename DocumentPredicate>
+	size_t CheckQueries(const SearchServer& search_server, DocumentPredicate document_predicate) {
+		// Прогрев: арена запроса и буферы потока дорастают до нужного размера
+		for (int i = 0; i < 3; ++i) {
+			for (const string& query : QUERIES) {
+				search_server.FindTopDocuments(query, document_predicate);
+			}
+		}
+		return CountQueryAllocations(search_server, document_predicate);
+	}
+
+	const vector<int> MATCH_DOCUMENT_IDS = { 0, 1, 17, 256, 4999 };
+
+	// Совпадения MatchDocument и MatchDocuments: допустимы только буферы
+	// возвращаемых векторов слов и вектор результатов MatchDocuments
+	size_t CheckMatches(const SearchServer& search_server) {
+		for (int i = 0; i < 3; ++i) {
+			for (const string& query : QUERIES) {
+				for (const int document_id : MATCH_DOCUMENT_IDS) {
+					search_server.MatchDocument(query, document_id);
+				}
+				search_server.MatchDocuments(query, MATCH_DOCUMENT_IDS);
+			}
+		}
+
+		size_t extra = 0;
+		for (const string& query : QUERIES) {
+			for (const int document_id : MATCH_DOCUMENT_IDS) {
+				allocation_count = 0;
+				allocated_bytes = 0;
+				counting = true;
+				const auto [words, status] = search_server.MatchDocument(query, document_id);
+				counting = false;
+				if (allocation_count != (words.empty() ? 0 : 1) || allocated_bytes != words.size() * sizeof(string_view)) {
+					cerr << "MatchDocument \""s << query << "\", "s << document_id << ": "s << allocation_count << " allocations, "s
+						<< allocated_bytes << " bytes for "s << words.size() << " words"s << endl;
+					++extra;
+				}
+			}
+
+			allocation_count = 0;
+			allocated_bytes = 0;
+			counting = true;
+			const vector<SearchServer::MatchResult> matches = search_server.MatchDocuments(query, MATCH_DOCUMENT_IDS);
+			counting = false;
+			size_t result_allocations = 1;
+			size_t result_bytes = matches.size() * sizeof(SearchServer::MatchResult);
+			for (const auto& [words, status] : matches) {
+				result_allocations += words.empty() ? 0 : 1;
+				result_bytes += words.size() * sizeof(string_view);
+			}
+			if (allocation_count != result_allocations || allocated_bytes != result_bytes) {
+				cerr << "MatchDocuments \""s << query << "\": "s << allocation_count << " allocations, "s
+					<< allocated_bytes << " bytes instead of "s << result_bytes << endl;
+				++extra;
+			}
+		}
+		return extra;
+	}
+
+	// Огромный запрос не оставляет арене потока буфер больше предела
+	size_t CheckArenaCapacity() {
+		{
+			const QueryArena::Scope arena;
+			[[maybe_unused]] auto _ = arena.Resource()->allocate(4 * QueryArena::MAX_RETAINED_CAPACITY);
+		}
+		{
+			const QueryArena::Scope arena;
+			[[maybe_unused]] auto _ = arena.Resource()->allocate(4 * QueryArena::MAX_RETAINED_CAPACITY);
+		}
+		const size_t capacity = QueryArena::ForThread().GetCapacity();
+		if (capacity > QueryArena::MAX_RETAINED_CAPACITY) {
+			cerr << "Query arena retained "s << capacity << " bytes"s << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+}
+
+int main() {
+	SearchServer search_server("and with"s);
+	AddDocuments(search_server);
+
+	size_t failures = 0;
+	for (const IndexLayout layout : { IndexLayout::DOCUMENT_ORDERED, IndexLayout::IMPACT_ORDERED }) {
+		search_server.SetIndexLayout(layout);
+		failures += CheckQueries(search_server, DocumentFilter::Status(DocumentStatus::ACTUAL));
+		failures += CheckQueries(search_server, DocumentFilter::IdModulo(3, 1) && DocumentFilter::RatingBetween(2, 7));
+		failures += CheckQueries(search_server, [](int document_id, DocumentStatus, int) {
+			return document_id % 2 == 0;
+			});
+		failures += CheckMatches(search_server);
+	}
+
+	failures += CheckArenaCapacity();
+
+	if (failures > 0) {
+		cerr << failures << " calls allocated after warm-up"s << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "query_allocation_test: OK"s << endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "../search_server.h"
+#include "../term_dictionary.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+	size_t failures = 0;
+
+	void Check(bool condition, const string& message) {
+		if (!condition) {
+			cerr << message << endl;
+			++failures;
+		}
+	}
+
+	vector<pair<string, const PostingList*>> CollectMatches(const TermDictionary& dictionary, string_view pattern) {
+		vector<pair<string, const PostingList*>> matches;
+		dictionary.ForEachMatch(pattern, [&matches](string_view term, const PostingList* postings) {
+			matches.push_back({ string(term), postings });
+			});
+		return matches;
+	}
+
+	// Вставки и удаления на месте сверяются с std::map: короткие слова
+	// из малого алфавита дают длинные общие префиксы и частые разделения блоков
+	void TestMatchesMap() {
+		MemoryCounter counter;
+		TermDictionary dictionary(&counter);
+		map<string, const PostingList*> expected;
+		vector<PostingList> postings(8, PostingList(&counter));
+		mt19937 generator(42);
+		for (int step = 0; step < 20000; ++step) {
+			string term(1 + generator() % 6, ' ');
+			for (char& c : term) {
+				c = static_cast<char>('a' + generator() % 3);
+			}
+			if (generator() % 3 == 0) {
+				dictionary.Erase(term);
+				expected.erase(term);
+			}
+			else {
+				const PostingList* word_postings = &postings[generator() % postings.size()];
+				dictionary.Insert(term, word_postings);
+				expected[term] = word_postings;
+			}
+			Check(dictionary.size() == expected.size(), "Size mismatch at step "s + to_string(step));
+			if (step % 500 == 0) {
+				for (const string& pattern : { "a*"s, "ab*"s, "b*c"s, "c*a*b"s, "aaa*"s }) {
+					vector<pair<string, const PostingList*>> expected_matches;
+					for (const auto& [word, word_postings] : expected) {
+						if (MatchesWordPattern(pattern, word)) {
+							expected_matches.push_back({ word, word_postings });
+						}
+					}
+					Check(CollectMatches(dictionary, pattern) == expected_matches, "Pattern "s + pattern + " mismatch at step "s + to_string(step));
+				}
+			}
+		}
+	}
+
+	void TestLeadingWildcardRejected() {
+		MemoryCounter counter;
+		TermDictionary dictionary(&counter);
+		try {
+			CollectMatches(dictionary, "*ing"sv);
+			Check(false, "Dictionary accepted a leading wildcard"s);
+		}
+		catch (const invalid_argument&) {
+		}
+
+		SearchServer search_server(""s);
+		search_server.AddDocument(1, "holding sing"s, DocumentStatus::ACTUAL, { 1 });
+		for (const string& query : { "*ing"s, "-*ing"s, "*"s, "hold* *"s }) {
+			try {
+				search_server.FindTopDocuments(query);
+				Check(false, "Query \""s + query + "\" was accepted"s);
+			}
+			catch (const invalid_argument&) {
+			}
+		}
+		Check(search_server.FindTopDocuments("hold*"s).size() == 1 && search_server.FindTopDocuments("s*g"s).size() == 1,
+			"Patterns starting with a letter are not expanded"s);
+	}
+
+}
+
+int main() {
+	TestMatchesMap();
+	TestLeadingWildcardRejected();
+	if (failures > 0) {
+		cerr << failures << " checks failed"s << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "term_dictionary_test: OK"s << endl;
+	return EXIT_SUCCESS;
+}